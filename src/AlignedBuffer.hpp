@@ -0,0 +1,95 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace sage
+{
+    // Fixed size heap array aligned to a cache line (so rows of pixels don't straddle lines unnecessarily and the
+    // buffer is friendly to vector loads/stores). Resizing discards the contents and zero fills, unless the caller
+    // asks to do that itself (to choose which threads first touch, and so place, the memory).
+    template <typename T, std::size_t alignment = 64>
+    class AlignedBuffer
+    {
+        T* ptr = nullptr;
+        std::size_t count = 0;
+
+        void release()
+        {
+            if (ptr) ::operator delete(ptr, std::align_val_t{alignment});
+            ptr = nullptr;
+            count = 0;
+        }
+
+      public:
+        AlignedBuffer() = default;
+        explicit AlignedBuffer(std::size_t size)
+        {
+            resize(size);
+        }
+        AlignedBuffer(const AlignedBuffer&) = delete;
+        AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+        AlignedBuffer(AlignedBuffer&& other) noexcept
+            : ptr(std::exchange(other.ptr, nullptr)), count(std::exchange(other.count, 0))
+        {
+        }
+        AlignedBuffer& operator=(AlignedBuffer&& other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                ptr = std::exchange(other.ptr, nullptr);
+                count = std::exchange(other.count, 0);
+            }
+            return *this;
+        }
+        ~AlignedBuffer()
+        {
+            release();
+        }
+
+        void resize(std::size_t size, bool zeroFill = true)
+        {
+            release();
+            if (size == 0) return;
+            ptr = static_cast<T*>(::operator new(size * sizeof(T), std::align_val_t{alignment}));
+            count = size;
+            if (zeroFill) std::fill_n(ptr, count, T{});
+        }
+
+        T* data()
+        {
+            return ptr;
+        }
+        const T* data() const
+        {
+            return ptr;
+        }
+        std::size_t size() const
+        {
+            return count;
+        }
+        T* begin()
+        {
+            return ptr;
+        }
+        T* end()
+        {
+            return ptr + count;
+        }
+        T& operator[](std::size_t i)
+        {
+            return ptr[i];
+        }
+        const T& operator[](std::size_t i) const
+        {
+            return ptr[i];
+        }
+    };
+} // namespace sage
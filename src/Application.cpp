@@ -10,16 +10,20 @@
 #include "SceneFactory.hpp"
 #include "slib.hpp"
 
+#include <chrono>
+#include <iterator>
 #include <memory>
-#include <omp.h>
 #include <SDL2/SDL.h>
 
 namespace sage
 {
+    static constexpr SceneInit sceneInits[] = {
+        spyroSceneInit, isometricGameLevel, vikingRoomSceneInit, instancedVillageInit};
 
     inline void Application::initSDL()
     {
-        sdlWindow = SDL_CreateWindow("3D Software Renderer", 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+        sdlWindow =
+            SDL_CreateWindow("3D Software Renderer", 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_RESIZABLE);
         if (sdlWindow == nullptr)
         {
             std::cout << "Could not initialise SDL window. Exiting..." << std::endl;
@@ -34,53 +38,138 @@ namespace sage
         }
 
         SDL_Init(SDL_INIT_EVERYTHING);
+        // Smooth upscaling when the render scale is below 100%
+        SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
         SDL_SetRelativeMouseMode(SDL_TRUE);
-        SDL_WarpMouseInWindow(sdlWindow, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2);
+        warpMouseToCentre();
 
         loop = SDL_TRUE;
     }
 
+    void Application::warpMouseToCentre() const
+    {
+        int width, height;
+        SDL_GetWindowSize(sdlWindow, &width, &height);
+        SDL_WarpMouseInWindow(sdlWindow, width / 2, height / 2);
+    }
+
     inline void Application::initGui()
     {
-        std::unique_ptr<Scene> scene1 = spyroSceneInit(renderer.get());
-        std::unique_ptr<Scene> scene2 = isometricGameLevel(renderer.get());
-        std::unique_ptr<Scene> scene3 = vikingRoomSceneInit(renderer.get());
-        scenes.push_back(std::move(scene1));
-        scenes.push_back(std::move(scene2));
-        scenes.push_back(std::move(scene3));
+        scenes.resize(std::size(sceneInits));
+        loadingScenes.resize(std::size(sceneInits));
         changeScene(2); // default scene
+        // Only the default scene is waited for; the others load when first selected
+        loadingScenes[2].wait();
+        pollSceneLoads();
 
         eventManager->Subscribe([p = this] { p->changeScene(0); }, *gui->scene1ButtonDown);
         eventManager->Subscribe([p = this] { p->changeScene(1); }, *gui->scene2ButtonDown);
         eventManager->Subscribe([p = this] { p->changeScene(2); }, *gui->scene3ButtonDown);
+        eventManager->Subscribe([p = this] { p->changeScene(3); }, *gui->scene4ButtonDown);
         eventManager->Subscribe([p = this] { p->quit(); }, *gui->quitButtonDown);
         eventManager->Subscribe([p = renderer.get()] { p->setShader(sage::FLAT); }, *gui->flatShaderButtonDown);
         eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->flatShaderButtonDown);
         eventManager->Subscribe(
             [p = renderer.get()] { p->setShader(sage::GOURAUD); }, *gui->gouraudShaderButtonDown);
         eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->gouraudShaderButtonDown);
+        eventManager->Subscribe(
+            [p = renderer.get()] { p->zPrepass = !p->zPrepass; }, *gui->zPrepassButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->zPrepassButtonDown);
+        eventManager->Subscribe([p = renderer.get()] { p->setMsaa(!p->Msaa()); }, *gui->msaaButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->msaaButtonDown);
+        eventManager->Subscribe(
+            [p = renderer.get()] { p->temporalReuse = !p->temporalReuse; }, *gui->temporalButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->temporalButtonDown);
+        eventManager->Subscribe(
+            [p = renderer.get()] { p->checkerboard = !p->checkerboard; }, *gui->checkerboardButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->checkerboardButtonDown);
         eventManager->Subscribe(
             [p = renderer.get()] { p->setTextureFilter(sage::NEIGHBOUR); }, *gui->neighbourButtonDown);
         eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->neighbourButtonDown);
         eventManager->Subscribe(
             [p = renderer.get()] { p->setTextureFilter(sage::BILINEAR); }, *gui->bilinearButtonDown);
         eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->bilinearButtonDown);
+        eventManager->Subscribe(
+            [p = renderer.get()] { p->setShadowMode(sage::SHADOWS_OFF); }, *gui->shadowsOffButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->shadowsOffButtonDown);
+        eventManager->Subscribe(
+            [p = renderer.get()] { p->setShadowMode(sage::SHADOWS_HARD); }, *gui->hardShadowsButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->hardShadowsButtonDown);
+        eventManager->Subscribe(
+            [p = renderer.get()] { p->setShadowMode(sage::SHADOWS_PCF); }, *gui->pcfShadowsButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->pcfShadowsButtonDown);
+        eventManager->Subscribe(
+            [p = renderer.get()] { p->setDepthFormat(sage::DEPTH_32F); }, *gui->depth32FButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->depth32FButtonDown);
+        eventManager->Subscribe(
+            [p = renderer.get()] { p->setDepthFormat(sage::DEPTH_24); }, *gui->depth24ButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->depth24ButtonDown);
+        eventManager->Subscribe(
+            [p = renderer.get()] { p->setDepthFormat(sage::DEPTH_16); }, *gui->depth16ButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->depth16ButtonDown);
+        eventManager->Subscribe([p = this] { p->setRenderScale(0.5f); }, *gui->renderScale50ButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->renderScale50ButtonDown);
+        eventManager->Subscribe([p = this] { p->setRenderScale(0.75f); }, *gui->renderScale75ButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->renderScale75ButtonDown);
+        eventManager->Subscribe([p = this] { p->setRenderScale(1); }, *gui->renderScale100ButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->renderScale100ButtonDown);
+        eventManager->Subscribe([p = this] { p->toggleDynamicResolution(); }, *gui->dynamicResolutionButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->dynamicResolutionButtonDown);
+        eventManager->Subscribe([p = renderer.get()] { p->setLodThreshold(0); }, *gui->lodOffButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->lodOffButtonDown);
+        eventManager->Subscribe([p = renderer.get()] { p->setLodThreshold(1); }, *gui->lod1pxButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->lod1pxButtonDown);
+        eventManager->Subscribe([p = renderer.get()] { p->setLodThreshold(2); }, *gui->lod2pxButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->lod2pxButtonDown);
+        eventManager->Subscribe([p = renderer.get()] { p->setLodThreshold(4); }, *gui->lod4pxButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->lod4pxButtonDown);
     }
 
     void Application::init()
     {
         initSDL();
-        renderer = std::make_unique<Renderer>(sdlRenderer);
+        const ThreadConfig threads = ThreadConfig::FromEnvironment();
+        renderer = std::make_unique<Renderer>(
+            sdlRenderer, static_cast<int>(SCREEN_WIDTH), static_cast<int>(SCREEN_HEIGHT), threads);
         gui = std::make_unique<GUI>(sdlWindow, sdlRenderer);
+        // Models are parsed on the loader thread, with as many OpenMP threads as the renderer uses
+        loaderPool = std::make_unique<LoaderPool>(1, threads.Resolve());
         menuMouseEnabled = false;
         initGui();
-        omp_set_num_threads(omp_get_max_threads());
     }
 
     void Application::changeScene(int newScene)
     {
-        scenes.at(newScene)->LoadScene();
         disableMouse();
+        if (scenes.at(newScene))
+        {
+            scenes[newScene]->LoadScene();
+            pendingScene = -1;
+            return;
+        }
+        // The current scene keeps rendering until the new one is ready (see pollSceneLoads)
+        if (!loadingScenes[newScene].valid())
+        {
+            loadingScenes[newScene] =
+                loaderPool->Submit([init = sceneInits[newScene], p = renderer.get()] { return init(p); });
+        }
+        pendingScene = newScene;
+    }
+
+    void Application::pollSceneLoads()
+    {
+        for (size_t i = 0; i < loadingScenes.size(); ++i)
+        {
+            auto& loading = loadingScenes[i];
+            if (!loading.valid() || loading.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                continue;
+            scenes[i] = loading.get();
+            if (static_cast<int>(i) == pendingScene)
+            {
+                scenes[i]->LoadScene();
+                pendingScene = -1;
+            }
+        }
     }
 
     void Application::disableMouse()
@@ -103,9 +192,22 @@ namespace sage
 
     void Application::update()
     {
+        // Nothing changed on screen last frame: wait for input rather than spin through identical frames.
+        // Holding a key down keeps the camera (and so the renderer) busy, so there's no wait then.
+        const bool idle = renderer->Idle();
+        if (idle)
+        {
+            SDL_WaitEventTimeout(nullptr, idleWaitMs);
+            clock.tick(); // The wait isn't frame time
+        }
         clock.tick();
+        pollSceneLoads();
+        gui->loadingScene = pendingScene >= 0;
         fpsCounter.Update();
         gui->fpsCounter = fpsCounter.fps_current;
+        if (dynamicResolution.enabled && !idle) renderer->setRenderScale(dynamicResolution.Update(clock.delta));
+        gui->renderScale = renderer->RenderScale();
+        gui->dynamicResolution = dynamicResolution.enabled;
         renderer->camera.Update(clock.delta);
 
         while (SDL_PollEvent(&event))
@@ -126,9 +228,13 @@ namespace sage
             {
                 if (!menuMouseEnabled)
                 {
-                    SDL_WarpMouseInWindow(sdlWindow, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2);
+                    warpMouseToCentre();
                 }
             }
+            else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+            {
+                renderer->Resize(event.window.data1, event.window.data2);
+            }
             else if (event.type == SDL_KEYDOWN)
             {
                 switch (event.key.keysym.sym)
@@ -154,8 +260,25 @@ namespace sage
         }
     }
 
-    void Application::cleanup() const
+    void Application::setRenderScale(float scale)
+    {
+        // Picking a scale by hand takes over from the controller
+        dynamicResolution.enabled = false;
+        renderer->setRenderScale(scale);
+    }
+
+    void Application::toggleDynamicResolution()
+    {
+        dynamicResolution.enabled = !dynamicResolution.enabled;
+        dynamicResolution.Reset(renderer->RenderScale());
+    }
+
+    void Application::cleanup()
     {
+        // The renderer's framebuffer texture has to be destroyed before the SDL renderer that owns it. Loads in
+        // flight refer to the renderer, so they're finished (or dropped) first.
+        loaderPool.reset();
+        renderer.reset();
         SDL_DestroyWindow(sdlWindow);
         SDL_DestroyRenderer(sdlRenderer);
         SDL_Quit();
@@ -4,12 +4,15 @@
 
 #pragma once
 
+#include "DynamicResolution.hpp"
 #include "EventManager.hpp"
 #include "GUI.hpp"
+#include "LoaderPool.hpp"
 #include "Renderer.hpp"
 #include "Scene.hpp"
 #include "utils.hpp"
 
+#include <future>
 #include <memory>
 #include <vector>
 
@@ -17,26 +20,40 @@ namespace sage
 {
     class Application
     {
+        // While the renderer has nothing new to draw, the loop sleeps until input arrives, or for at most this
+        // long (to notice scenes that finish loading)
+        static constexpr int idleWaitMs = 100;
+
         std::unique_ptr<GUI> gui;
         std::unique_ptr<Renderer> renderer;
+        // Scenes are built on the loader pool the first time they're asked for. Until then the slot is empty and
+        // the load is tracked in loadingScenes.
         std::vector<std::unique_ptr<Scene>> scenes;
+        std::vector<std::future<std::unique_ptr<Scene>>> loadingScenes;
+        int pendingScene = -1; // Scene to switch to once it has loaded
         std::unique_ptr<EventManager> eventManager;
         SDL_Window* sdlWindow{};
         SDL_Renderer* sdlRenderer{};
         FPSCounter fpsCounter{};
         Clock clock{};
+        DynamicResolution dynamicResolution{};
         SDL_bool loop = SDL_FALSE;
         SDL_Event event{};
+        std::unique_ptr<LoaderPool> loaderPool; // Last, so it is stopped before anything its jobs refer to
         bool menuMouseEnabled{};
         void changeScene(int newScene);
+        void pollSceneLoads();
         void quit();
         void init();
         void initGui();
         void initSDL();
         void draw() const;
         void update();
-        void cleanup() const;
+        void cleanup();
         void disableMouse();
+        void warpMouseToCentre() const;
+        void setRenderScale(float scale);
+        void toggleDynamicResolution();
 
       public:
         void Run();
@@ -0,0 +1,90 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "Checkerboard.hpp"
+#include "smath.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace sage
+{
+    Checkerboard::Checkerboard() : view(smath::identity())
+    {
+    }
+
+    void Checkerboard::Begin()
+    {
+        parity ^= 1;
+    }
+
+    void Checkerboard::Fill(Framebuffer& framebuffer, const slib::mat4& viewMatrix, JobSystem& jobs)
+    {
+        const int w = framebuffer.Width();
+        const int h = framebuffer.Height();
+        if (w != width || h != height)
+        {
+            width = w;
+            height = h;
+            history.resize(static_cast<std::size_t>(width) * height, false);
+            valid = false;
+        }
+        const bool hasHistory = valid;
+        // Nothing has moved since the last frame, so its pixels are exact
+        const bool still = valid && viewMatrix.data == view.data;
+        auto* pixels = framebuffer.Color();
+
+        jobs.ParallelFor(static_cast<std::size_t>(height), 8, [&](std::size_t begin, std::size_t end) {
+            for (auto y = static_cast<int>(begin); y < static_cast<int>(end); ++y)
+            {
+                const auto row = static_cast<std::size_t>(y) * width;
+                // The first skipped pixel of the row; the rest follow every other pixel
+                for (int x = static_cast<int>((y + parity + 1) & 1); x < width; x += 2)
+                {
+                    const auto i = row + x;
+                    if (still)
+                    {
+                        pixels[i] = history[i];
+                        continue;
+                    }
+
+                    // The rendered pixels around this one (all four of its edge neighbours, on screen)
+                    std::uint32_t neighbours[4];
+                    int count = 0;
+                    if (x > 0) neighbours[count++] = pixels[i - 1];
+                    if (x < width - 1) neighbours[count++] = pixels[i + 1];
+                    if (y > 0) neighbours[count++] = pixels[i - width];
+                    if (y < height - 1) neighbours[count++] = pixels[i + width];
+
+                    std::uint32_t filled = 0xff000000u;
+                    for (int shift = 0; shift < 24; shift += 8)
+                    {
+                        int low = 255, high = 0, sum = 0;
+                        for (int n = 0; n < count; ++n)
+                        {
+                            const int channel = static_cast<int>(neighbours[n] >> shift & 0xff);
+                            low = std::min(low, channel);
+                            high = std::max(high, channel);
+                            sum += channel;
+                        }
+                        const int last = static_cast<int>(history[i] >> shift & 0xff);
+                        const int channel =
+                            hasHistory ? std::clamp(last, low, high) : (sum + count / 2) / std::max(count, 1);
+                        filled |= static_cast<std::uint32_t>(channel) << shift;
+                    }
+                    pixels[i] = filled;
+                }
+                std::memcpy(
+                    history.data() + row, pixels + row, static_cast<std::size_t>(width) * sizeof(std::uint32_t));
+            }
+        });
+        view = viewMatrix;
+        valid = true;
+    }
+
+    void Checkerboard::Invalidate()
+    {
+        valid = false;
+    }
+} // namespace sage
@@ -0,0 +1,44 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "AlignedBuffer.hpp"
+#include "Framebuffer.hpp"
+#include "JobSystem.hpp"
+#include "slib.hpp"
+
+#include <cstdint>
+
+namespace sage
+{
+    // Checkerboard rendering: each frame rasterizes only the pixels where (x + y) % 2 is the frame's Parity, which
+    // alternates, and Fill reconstructs the other half. With the camera still, a missing pixel was rendered last
+    // frame and is taken from there. While it moves, last frame's colour is clamped to the range of the pixel's
+    // four rendered neighbours, which keeps detail where the two frames agree and falls back towards the
+    // neighbours (rather than ghosting) where they don't.
+    class Checkerboard
+    {
+        int width = 0;
+        int height = 0;
+        AlignedBuffer<std::uint32_t> history; // The last frame, filled
+        slib::mat4 view;                      // The last frame's
+        bool valid = false;
+        unsigned int parity = 0;
+
+      public:
+        Checkerboard();
+        // Starts a frame: flips the parity
+        void Begin();
+        // 0 or 1: pixels with (x + y) % 2 equal to it are rendered this frame
+        unsigned int Parity() const
+        {
+            return parity;
+        }
+        // Fills in the pixels this frame skipped, then keeps the frame for the next one
+        void Fill(Framebuffer& framebuffer, const slib::mat4& viewMatrix, JobSystem& jobs);
+        // Drops the last frame, so the next fill only has the neighbours to go on
+        void Invalidate();
+    };
+} // namespace sage
@@ -0,0 +1,57 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "DepthRasterizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sage
+{
+    bool DepthTriangle::Setup(
+        const slib::vec3& p1,
+        const slib::vec3& p2,
+        const slib::vec3& p3,
+        int width,
+        int height,
+        bool cullBackfaces)
+    {
+        // Same orientation as Rasterizer: edge i is opposite vertex i, and the area is positive when front facing.
+        a[0] = p3.y - p2.y;
+        b[0] = p2.x - p3.x;
+        a[1] = p1.y - p3.y;
+        b[1] = p3.x - p1.x;
+        a[2] = p2.y - p1.y;
+        b[2] = p1.x - p2.x;
+        c[0] = -a[0] * p2.x - b[0] * p2.y;
+        c[1] = -a[1] * p3.x - b[1] * p3.y;
+        c[2] = -a[2] * p1.x - b[2] * p1.y;
+
+        float area = (p3.x - p1.x) * (p2.y - p1.y) - (p3.y - p1.y) * (p2.x - p1.x);
+        if (area == 0 || (cullBackfaces && area < 0)) return false;
+        if (area < 0)
+        {
+            // Flip the edges of back faces so that "inside" is always positive
+            for (int i = 0; i < 3; ++i)
+            {
+                a[i] = -a[i];
+                b[i] = -b[i];
+                c[i] = -c[i];
+            }
+            area = -area;
+        }
+
+        xmin = std::max(static_cast<int>(std::floor(std::min({p1.x, p2.x, p3.x}))), 0);
+        xmax = std::min(static_cast<int>(std::ceil(std::max({p1.x, p2.x, p3.x}))), width - 1);
+        ymin = std::max(static_cast<int>(std::floor(std::min({p1.y, p2.y, p3.y}))), 0);
+        ymax = std::min(static_cast<int>(std::ceil(std::max({p1.y, p2.y, p3.y}))), height - 1);
+        if (xmin > xmax || ymin > ymax) return false;
+
+        // z = (e0 * z1 + e1 * z2 + e2 * z3) / area, which is a plane in x and y
+        dzdx = (a[0] * p1.z + a[1] * p2.z + a[2] * p3.z) / area;
+        dzdy = (b[0] * p1.z + b[1] * p2.z + b[2] * p3.z) / area;
+        z0 = (c[0] * p1.z + c[1] * p2.z + c[2] * p3.z) / area;
+        return true;
+    }
+} // namespace sage
@@ -0,0 +1,77 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "slib.hpp"
+
+#include <cmath>
+
+namespace sage
+{
+    // Triangle setup for depth-only rasterization: three edge functions (a * x + b * y + c >= 0 inside) and the
+    // screen-space depth plane. No attributes are carried, so the whole triangle is a handful of floats.
+    struct DepthTriangle
+    {
+        int xmin, xmax, ymin, ymax;
+        float a[3], b[3], c[3];
+        float dzdx, dzdy, z0;
+
+        // Returns false if the triangle is degenerate, off screen or (when cullBackfaces is set) facing away.
+        bool Setup(
+            const slib::vec3& p1,
+            const slib::vec3& p2,
+            const slib::vec3& p3,
+            int width,
+            int height,
+            bool cullBackfaces);
+
+        // The covered pixels of row y are [x0, x1]. Returns false if the row is empty.
+        bool Span(int y, int& x0, int& x1) const
+        {
+            x0 = xmin;
+            x1 = xmax;
+            for (int i = 0; i < 3; ++i)
+            {
+                const float rowValue = b[i] * y + c[i];
+                if (a[i] == 0)
+                {
+                    if (rowValue < 0) return false;
+                    continue;
+                }
+                const float edge = -rowValue / a[i];
+                if (a[i] > 0 && edge > x0)
+                {
+                    if (edge > x1) return false;
+                    x0 = static_cast<int>(std::ceil(edge));
+                }
+                else if (a[i] < 0 && edge < x1)
+                {
+                    if (edge < x0) return false;
+                    x1 = static_cast<int>(std::floor(edge));
+                }
+            }
+            return x0 <= x1;
+        }
+    };
+
+    // Depth-only rasterization of rows [yBegin, yEnd) into depth (row stride "width"). The covered pixels of each
+    // row are found analytically, so the inner loop is a single depth step and compare per pixel.
+    // "test" is called as test(z, stored) and is responsible for writing stored.
+    template <typename DepthTest>
+    void rasterizeDepth(const DepthTriangle& tri, float* depth, int width, int yBegin, int yEnd, DepthTest test)
+    {
+        const int y0 = tri.ymin > yBegin ? tri.ymin : yBegin;
+        const int y1 = tri.ymax < yEnd - 1 ? tri.ymax : yEnd - 1;
+        for (int y = y0; y <= y1; ++y)
+        {
+            int x0, x1;
+            if (!tri.Span(y, x0, x1)) continue;
+            float* row = depth + y * width;
+            float z = tri.z0 + tri.dzdx * x0 + tri.dzdy * y;
+            for (int x = x0; x <= x1; ++x, z += tri.dzdx)
+                test(z, row[x]);
+        }
+    }
+} // namespace sage
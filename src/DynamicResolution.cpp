@@ -0,0 +1,51 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sage
+{
+    float DynamicResolution::Update(std::uint32_t frameMs)
+    {
+        // Ignore hitches (loading, window drags) rather than let them drag the resolution down
+        const float sample = std::min(static_cast<float>(frameMs), targetFrameMs * 4);
+        smoothedFrameMs = smoothedFrameMs == 0 ? sample : smoothedFrameMs * 0.9f + sample * 0.1f;
+
+        if (cooldown > 0)
+        {
+            --cooldown;
+            return scale;
+        }
+        if (smoothedFrameMs <= targetFrameMs * upperBand && smoothedFrameMs >= targetFrameMs * lowerBand)
+            return scale;
+
+        // Rasterization cost is roughly proportional to the pixel count, i.e. scale squared, so when over budget
+        // jump (up to four steps) towards the scale that should fit. Going back up is one step at a time, since
+        // overshooting upwards is what causes stutter.
+        float next = scale + step;
+        if (smoothedFrameMs > targetFrameMs)
+        {
+            const float ideal = scale * std::sqrt(targetFrameMs / smoothedFrameMs);
+            next = std::clamp(ideal, scale - step * 4, scale - step);
+        }
+        next = std::round(next / step) * step;
+        next = std::clamp(next, minScale, maxScale);
+        if (next != scale)
+        {
+            scale = next;
+            cooldown = cooldownFrames;
+        }
+        return scale;
+    }
+
+    void DynamicResolution::Reset(float currentScale)
+    {
+        scale = currentScale;
+        smoothedFrameMs = 0;
+        cooldown = cooldownFrames;
+    }
+} // namespace sage
@@ -0,0 +1,40 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace sage
+{
+    // Picks the render scale that holds the frame time near a target. Frame times are smoothed, nothing happens
+    // while they stay inside a dead band around the target, and after each change the controller waits a few
+    // frames for the new resolution to show up in the measurements. Together these stop it oscillating.
+    class DynamicResolution
+    {
+        static constexpr float step = 0.05f;           // Scales are multiples of this, to limit reallocations
+        static constexpr float upperBand = 1.05f;      // Scale down above target * upperBand
+        static constexpr float lowerBand = 0.8f;       // Scale up below target * lowerBand
+        static constexpr int cooldownFrames = 15;
+
+        float smoothedFrameMs = 0;
+        int cooldown = 0;
+        float scale = 1;
+
+      public:
+        bool enabled = false;
+        float targetFrameMs = 1000.0f / 30.0f;
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+
+        // Feeds in the last frame's time (e.g. Clock::delta) and returns the scale to render the next frame at.
+        float Update(std::uint32_t frameMs);
+        // Restarts from the given scale, e.g. when the controller is switched on.
+        void Reset(float currentScale);
+        float Scale() const
+        {
+            return scale;
+        }
+    };
+} // namespace sage
@@ -0,0 +1,47 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "FrameArena.hpp"
+
+#include <algorithm>
+
+namespace sage
+{
+    void* FrameArena::allocate(std::size_t bytes, std::size_t alignment)
+    {
+        for (; current < blocks.size(); ++current, offset = 0)
+        {
+            auto& block = blocks[current];
+            const std::size_t start = (offset + alignment - 1) & ~(alignment - 1);
+            if (start + bytes <= block.size())
+            {
+                frameBytes += start + bytes - offset;
+                offset = start + bytes;
+                return block.data() + start;
+            }
+        }
+
+        // Out of room: chain on a block at least twice the size of the last one
+        const std::size_t previous = blocks.empty() ? 0 : blocks.back().size();
+        blocks.emplace_back().resize(std::max({bytes, previous * 2, minBlockSize}), false);
+        current = blocks.size() - 1;
+        offset = bytes;
+        frameBytes += bytes;
+        return blocks.back().data();
+    }
+
+    void FrameArena::Reset()
+    {
+        if (blocks.size() > 1)
+        {
+            // Room for the whole of this frame (plus some, as the next one may be a little bigger) in one block
+            const std::size_t size = frameBytes + frameBytes / 4;
+            blocks.clear();
+            blocks.emplace_back().resize(std::max(size, minBlockSize), false);
+        }
+        current = 0;
+        offset = 0;
+        frameBytes = 0;
+    }
+} // namespace sage
@@ -0,0 +1,52 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "AlignedBuffer.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace sage
+{
+    // Linear allocator for data that only lives for one frame. An allocation bumps an offset through a block,
+    // chaining on a bigger block when it runs out, and Reset frees everything at once. If a frame needed more
+    // than one block, Reset swaps them for a single block big enough for all of it, so once warmed up a frame
+    // never touches the heap.
+    //
+    // Not thread safe: each thread allocates from its own arena (see Renderer::frameArena).
+    class FrameArena
+    {
+        static constexpr std::size_t blockAlignment = 64;
+        static constexpr std::size_t minBlockSize = 64 * 1024;
+
+        std::vector<AlignedBuffer<std::byte, blockAlignment>> blocks;
+        std::size_t current = 0; // Block being allocated from
+        std::size_t offset = 0;  // Bytes used in blocks[current]
+        std::size_t frameBytes = 0; // Bytes handed out (padding included) since the last Reset
+
+        void* allocate(std::size_t bytes, std::size_t alignment);
+
+      public:
+        // Room for count Ts, default initialised (so left uninitialised for plain types). Nothing is destroyed
+        // on Reset, so only types that don't need destroying are allowed.
+        template <typename T>
+        std::span<T> Allocate(std::size_t count)
+        {
+            static_assert(std::is_trivially_destructible_v<T>, "Arena memory is reclaimed without destructors");
+            static_assert(alignof(T) <= blockAlignment);
+            if (count == 0) return {};
+            T* data = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+            std::uninitialized_default_construct_n(data, count);
+            return {data, count};
+        }
+
+        // Frees every allocation. Spans handed out before are invalid afterwards.
+        void Reset();
+    };
+} // namespace sage
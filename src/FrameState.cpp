@@ -0,0 +1,85 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "FrameState.hpp"
+
+#include <algorithm>
+
+namespace sage
+{
+    static bool sameTransform(const FrameState::RenderableState& a, const FrameState::RenderableState& b)
+    {
+        return a.position == b.position && a.eulerAngles == b.eulerAngles && a.scale == b.scale &&
+               a.col.r == b.col.r && a.col.g == b.col.g && a.col.b == b.col.b &&
+               a.ignoreLighting == b.ignoreLighting;
+    }
+
+    static bool overlaps(const SampleBounds& a, const SampleBounds& b)
+    {
+        return !a.Intersect(b).Empty();
+    }
+
+    bool FrameState::Changes(const FrameState& previous, std::vector<SampleBounds>& dirty) const
+    {
+        dirty.clear();
+        if (!valid || !previous.valid || generation != previous.generation || view.data != previous.view.data ||
+            width != previous.width || height != previous.height || prepass != previous.prepass ||
+            temporal != previous.temporal || checkerboard != previous.checkerboard || lights != previous.lights ||
+            renderables.size() != previous.renderables.size() || instanced.size() != previous.instanced.size())
+            return false;
+        for (size_t i = 0; i < instanced.size(); ++i)
+        {
+            if (instanced[i].instanced != previous.instanced[i].instanced ||
+                instanced[i].version != previous.instanced[i].version)
+                return false;
+        }
+
+        // A renderable that changed leaves stale pixels where it was and needs drawing where it is now
+        for (size_t i = 0; i < renderables.size(); ++i)
+        {
+            const auto& now = renderables[i];
+            const auto& before = previous.renderables[i];
+            if (now.renderable != before.renderable) return false;
+            if (sameTransform(now, before)) continue;
+            if (shadows) return false;
+            for (const auto* bounds : {&before.screenBounds, &now.screenBounds})
+            {
+                if (!bounds->Empty()) dirty.push_back(*bounds);
+            }
+        }
+
+        // Out to whole tiles, then any that overlap are merged until none do
+        for (auto& bounds : dirty)
+        {
+            bounds.xmin = bounds.xmin / tileSize * tileSize;
+            bounds.ymin = bounds.ymin / tileSize * tileSize;
+            bounds.xmax = std::min((bounds.xmax / tileSize + 1) * tileSize, width) - 1;
+            bounds.ymax = std::min((bounds.ymax / tileSize + 1) * tileSize, height) - 1;
+        }
+        for (size_t i = 0; i < dirty.size();)
+        {
+            bool merged = false;
+            for (size_t j = i + 1; j < dirty.size(); ++j)
+            {
+                if (!overlaps(dirty[i], dirty[j])) continue;
+                dirty[i] = {
+                    std::min(dirty[i].xmin, dirty[j].xmin),
+                    std::max(dirty[i].xmax, dirty[j].xmax),
+                    std::min(dirty[i].ymin, dirty[j].ymin),
+                    std::max(dirty[i].ymax, dirty[j].ymax)};
+                dirty.erase(dirty.begin() + static_cast<std::ptrdiff_t>(j));
+                merged = true;
+                break;
+            }
+            // A grown rectangle may now overlap ones already passed over
+            i = merged ? 0 : i + 1;
+        }
+
+        // Past half the screen, redrawing it all costs about the same and takes one pass
+        int area = 0;
+        for (const auto& bounds : dirty)
+            area += bounds.Count();
+        return area * 2 <= width * height;
+    }
+} // namespace sage
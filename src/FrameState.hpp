@@ -0,0 +1,65 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "Light.hpp"
+#include "Rasterizer.hpp"
+#include "slib.hpp"
+#include "smath.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace sage
+{
+    struct Renderable;
+    class InstancedRenderable;
+
+    // Everything a frame was rendered from that can change between frames: the view, the state of each
+    // renderable and light, and a generation number that the renderer bumps on any other change (settings, what
+    // is in the scene). Comparing the state a framebuffer was last rendered from with the next frame's tells
+    // whether it needs redrawing, and where (see Changes).
+    struct FrameState
+    {
+        // Dirty regions are made of square tiles of this many pixels
+        static constexpr int tileSize = 32;
+
+        struct RenderableState
+        {
+            const Renderable* renderable;
+            slib::vec3 position;
+            slib::vec3 eulerAngles;
+            slib::vec3 scale;
+            slib::Color col;
+            bool ignoreLighting;
+            SampleBounds screenBounds; // The pixels it can cover, from its bounding sphere
+        };
+
+        struct InstancedState
+        {
+            const InstancedRenderable* instanced;
+            unsigned int version;
+        };
+
+        bool valid = false;
+        std::uint64_t generation = 0;
+        slib::mat4 view = smath::identity();
+        int width = 0;
+        int height = 0;
+        bool prepass = false;
+        bool temporal = false;
+        bool checkerboard = false;
+        // A shadow map was in use. It sees the whole scene, so then anything moving can change pixels anywhere.
+        bool shadows = false;
+        std::vector<RenderableState> renderables;
+        std::vector<InstancedState> instanced;
+        std::vector<Light> lights;
+
+        // True if a frame rendered from this state differs from one rendered from previous only in some regions,
+        // which are put in dirty as non-overlapping tile aligned rectangles (none if the frames are the same).
+        // False if it has to be redrawn in full.
+        bool Changes(const FrameState& previous, std::vector<SampleBounds>& dirty) const;
+    };
+} // namespace sage
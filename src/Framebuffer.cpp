@@ -0,0 +1,173 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "Framebuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace sage
+{
+    // Rows [begin, end) of band thread out of threadCount. Every per-row pass over the buffers splits them this
+    // way, and JobSystem::RunOnEachThread always runs a band on the same worker, so each band is only ever touched
+    // by one thread.
+    static void band(unsigned int thread, unsigned int threadCount, int height, int& begin, int& end)
+    {
+        begin = static_cast<int>(static_cast<long long>(height) * thread / threadCount);
+        end = static_cast<int>(static_cast<long long>(height) * (thread + 1) / threadCount);
+    }
+
+    void Framebuffer::Resize(int _width, int _height, JobSystem& jobs)
+    {
+        if (_width == width && _height == height && surface) return;
+        width = std::max(_width, 1);
+        height = std::max(_height, 1);
+        allocate(jobs);
+    }
+
+    void Framebuffer::SetSamples(int _samples, JobSystem& jobs)
+    {
+        if (_samples == samples) return;
+        samples = _samples;
+        if (surface) allocate(jobs);
+    }
+
+    void Framebuffer::SetDepthFormat(DepthFormat format, JobSystem& jobs)
+    {
+        if (format == depth.Format()) return;
+        depth.setFormat(format, false);
+        if (!surface) return;
+        jobs.RunOnEachThread([this](unsigned int thread, unsigned int threadCount) {
+            int begin, end;
+            band(thread, threadCount, height, begin, end);
+            depth.clearRows(begin, end);
+        });
+    }
+
+    void Framebuffer::allocate(JobSystem& jobs)
+    {
+        if (surface) SDL_FreeSurface(surface);
+        if (texture) SDL_DestroyTexture(texture);
+        texture = nullptr;
+        const auto pixelCount = static_cast<std::size_t>(width) * height;
+        color.resize(pixelCount, false);
+        sampleColor.resize(samples > 1 ? pixelCount * samples : 0, false);
+        surface = SDL_CreateRGBSurfaceFrom(
+            color.data(), width, height, 32, width * static_cast<int>(sizeof(std::uint32_t)), 0, 0, 0, 0);
+        depth.resize(width * samples, height, false);
+
+        // The OS places a page on the memory node of the thread that first writes it, so the zero fill is done
+        // by the threads that will keep clearing and copying those rows.
+        jobs.RunOnEachThread([this](unsigned int thread, unsigned int threadCount) {
+            int begin, end;
+            band(thread, threadCount, height, begin, end);
+            std::fill(
+                color.data() + static_cast<std::size_t>(begin) * width,
+                color.data() + static_cast<std::size_t>(end) * width,
+                0u);
+            if (samples > 1)
+            {
+                std::fill(
+                    sampleColor.data() + static_cast<std::size_t>(begin) * width * samples,
+                    sampleColor.data() + static_cast<std::size_t>(end) * width * samples,
+                    0u);
+            }
+            depth.clearRows(begin, end);
+        });
+    }
+
+    void Framebuffer::Resolve(JobSystem& jobs)
+    {
+        jobs.RunOnEachThread([this](unsigned int thread, unsigned int threadCount) {
+            int begin, end;
+            band(thread, threadCount, height, begin, end);
+            const int half = samples / 2; // Rounds the averages to nearest
+            for (int y = begin; y < end; ++y)
+            {
+                std::uint32_t* row = color.data() + static_cast<std::size_t>(y) * width;
+                std::uint32_t* rowSamples = sampleColor.data() + static_cast<std::size_t>(y) * width * samples;
+                for (int x = 0; x < width; ++x)
+                {
+                    const std::uint32_t* pixel = rowSamples + static_cast<std::size_t>(x) * samples;
+                    int r = half, g = half, b = half;
+                    for (int s = 0; s < samples; ++s)
+                    {
+                        r += (pixel[s] >> 16) & 0xff;
+                        g += (pixel[s] >> 8) & 0xff;
+                        b += pixel[s] & 0xff;
+                    }
+                    row[x] = 0xff000000u | (r / samples) << 16 | (g / samples) << 8 | (b / samples);
+                }
+                // Cleared while still in cache; uncovered samples are black, as the colour buffer is
+                std::fill(rowSamples, rowSamples + static_cast<std::size_t>(width) * samples, 0u);
+            }
+        });
+    }
+
+    bool Framebuffer::Present(SDL_Renderer* renderer, JobSystem& jobs)
+    {
+        if (!texture || textureRenderer != renderer)
+        {
+            if (texture) SDL_DestroyTexture(texture);
+            // Same layout as the surface (32-bit XRGB), so rows copy straight across
+            texture =
+                SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING, width, height);
+            textureRenderer = renderer;
+            if (!texture) return false;
+        }
+
+        void* locked;
+        int lockedPitch;
+        if (SDL_LockTexture(texture, nullptr, &locked, &lockedPitch) != 0) return false;
+        const auto* pixels = color.data();
+        const auto rowBytes = static_cast<std::size_t>(width) * sizeof(std::uint32_t);
+        jobs.RunOnEachThread([&](unsigned int thread, unsigned int threadCount) {
+            int begin, end;
+            band(thread, threadCount, height, begin, end);
+            for (int y = begin; y < end; ++y)
+            {
+                std::memcpy(
+                    static_cast<char*>(locked) + static_cast<std::size_t>(y) * lockedPitch,
+                    pixels + static_cast<std::size_t>(y) * width,
+                    rowBytes);
+            }
+        });
+        SDL_UnlockTexture(texture);
+        Redraw(renderer);
+        return true;
+    }
+
+    void Framebuffer::Redraw(SDL_Renderer* renderer) const
+    {
+        if (!texture || textureRenderer != renderer) return;
+        // Stretched over the whole output, which upscales when rendering below the output resolution
+        SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+    }
+
+    void Framebuffer::Clear(int xmin, int ymin, int xmax, int ymax, JobSystem& jobs)
+    {
+        // Banded over the whole height like every other pass, so each thread keeps to its own rows
+        jobs.RunOnEachThread([=, this](unsigned int thread, unsigned int threadCount) {
+            int begin, end;
+            band(thread, threadCount, height, begin, end);
+            begin = std::max(begin, ymin);
+            end = std::min(end, ymax + 1);
+            for (int y = begin; y < end; ++y)
+            {
+                depth.clearSpan(y, xmin * samples, (xmax + 1) * samples);
+                if (samples == 1)
+                {
+                    std::uint32_t* row = color.data() + static_cast<std::size_t>(y) * width;
+                    std::fill(row + xmin, row + xmax + 1, 0u);
+                }
+            }
+        });
+    }
+
+    Framebuffer::~Framebuffer()
+    {
+        if (surface) SDL_FreeSurface(surface);
+        if (texture) SDL_DestroyTexture(texture);
+    }
+} // namespace sage
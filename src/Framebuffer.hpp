@@ -0,0 +1,99 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "AlignedBuffer.hpp"
+#include "JobSystem.hpp"
+#include "ZBuffer.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <cstdint>
+
+namespace sage
+{
+    // The colour and depth buffers that are rendered into. Both are sized at runtime and cache line aligned.
+    // The colour buffer is owned here and wrapped (not copied) by an SDL surface that the rasterizer draws
+    // through. It reaches the screen via a streaming texture that lives as long as the framebuffer keeps its size.
+    //
+    // When multisampled, each pixel has Samples() colours and depths, stored next to each other (pixel i's are
+    // [i * Samples(), (i + 1) * Samples())). The rasterizer draws into those instead of the surface, and Resolve
+    // averages them into it.
+    class Framebuffer
+    {
+        int width = 0;
+        int height = 0;
+        int samples = 1;
+        AlignedBuffer<std::uint32_t> color;
+        AlignedBuffer<std::uint32_t> sampleColor; // Empty unless multisampled
+        ZBuffer depth;                            // Per sample: width * samples wide
+        SDL_Surface* surface = nullptr;
+        SDL_Texture* texture = nullptr;
+        SDL_Renderer* textureRenderer = nullptr; // The renderer texture was created for
+
+        void allocate(JobSystem& jobs);
+
+      public:
+        Framebuffer() = default;
+        Framebuffer(const Framebuffer&) = delete;
+        Framebuffer& operator=(const Framebuffer&) = delete;
+        ~Framebuffer();
+
+        // Reallocates both buffers, cleared. Each band of rows is first touched by the thread that clears it every
+        // frame, so on a NUMA machine it's allocated on that thread's node.
+        void Resize(int _width, int _height, JobSystem& jobs);
+        // 1 (no multisampling) or 4. Reallocates the buffers, as Resize does.
+        void SetSamples(int _samples, JobSystem& jobs);
+        // Reallocates the depth buffer in the given format, cleared and placed as Resize does
+        void SetDepthFormat(DepthFormat format, JobSystem& jobs);
+        // Averages each pixel's samples into the colour buffer and clears them for the next frame
+        void Resolve(JobSystem& jobs);
+        // Uploads the colour buffer to the streaming texture and draws the texture over the whole output. The
+        // buffer is left as it is, so that a later frame can redraw just the parts of it that changed. False if
+        // the texture couldn't be created or locked, in which case nothing is drawn and the texture doesn't hold
+        // this buffer.
+        bool Present(SDL_Renderer* renderer, JobSystem& jobs);
+        // Draws the texture as the last Present left it, without uploading anything
+        void Redraw(SDL_Renderer* renderer) const;
+        // Clears colour and depth over the pixels [xmin, xmax] x [ymin, ymax]. Only depth when multisampled, as
+        // Resolve overwrites every colour.
+        void Clear(int xmin, int ymin, int xmax, int ymax, JobSystem& jobs);
+        void Clear(JobSystem& jobs)
+        {
+            Clear(0, 0, width - 1, height - 1, jobs);
+        }
+
+        int Width() const
+        {
+            return width;
+        }
+        int Height() const
+        {
+            return height;
+        }
+        int Samples() const
+        {
+            return samples;
+        }
+        SDL_Surface* Surface() const
+        {
+            return surface;
+        }
+        // The pixels of Surface(), row by row with no padding
+        std::uint32_t* Color()
+        {
+            return color.data();
+        }
+        ZBuffer* Depth()
+        {
+            return &depth;
+        }
+        // nullptr unless multisampled
+        std::uint32_t* SampleColor()
+        {
+            return samples > 1 ? sampleColor.data() : nullptr;
+        }
+    };
+} // namespace sage
@@ -45,6 +45,10 @@ namespace sage
                 {
                     scene3ButtonDown->InvokeAllCallbacks();
                 }
+                if(ImGui::MenuItem("Scene 4 (instanced)"))
+                {
+                    scene4ButtonDown->InvokeAllCallbacks();
+                }
                 ImGui::Separator();
                 if(ImGui::MenuItem("Quit"))
                 {
@@ -62,6 +66,23 @@ namespace sage
                 {
                     gouraudShaderButtonDown->InvokeAllCallbacks();
                 }
+                ImGui::Separator();
+                if(ImGui::MenuItem("Toggle Z-prepass"))
+                {
+                    zPrepassButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("Toggle 4x MSAA"))
+                {
+                    msaaButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("Toggle temporal reuse"))
+                {
+                    temporalButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("Toggle checkerboard"))
+                {
+                    checkerboardButtonDown->InvokeAllCallbacks();
+                }
                 ImGui::EndMenu();
             }
             if (ImGui::BeginMenu("Filtering"))
@@ -76,6 +97,88 @@ namespace sage
                 }
                 ImGui::EndMenu();
             }
+            if (ImGui::BeginMenu("Shadows"))
+            {
+                if(ImGui::MenuItem("Off"))
+                {
+                    shadowsOffButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("Hard"))
+                {
+                    hardShadowsButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("PCF"))
+                {
+                    pcfShadowsButtonDown->InvokeAllCallbacks();
+                }
+                ImGui::EndMenu();
+            }
+            if (ImGui::BeginMenu("Depth"))
+            {
+                if(ImGui::MenuItem("32-bit float"))
+                {
+                    depth32FButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("24-bit"))
+                {
+                    depth24ButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("16-bit"))
+                {
+                    depth16ButtonDown->InvokeAllCallbacks();
+                }
+                ImGui::EndMenu();
+            }
+            if (ImGui::BeginMenu("Render scale"))
+            {
+                if(ImGui::MenuItem("50%"))
+                {
+                    renderScale50ButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("75%"))
+                {
+                    renderScale75ButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("100%"))
+                {
+                    renderScale100ButtonDown->InvokeAllCallbacks();
+                }
+                ImGui::Separator();
+                if(ImGui::MenuItem("Toggle dynamic"))
+                {
+                    dynamicResolutionButtonDown->InvokeAllCallbacks();
+                }
+                ImGui::EndMenu();
+            }
+            if (ImGui::BeginMenu("LOD"))
+            {
+                if(ImGui::MenuItem("Off"))
+                {
+                    lodOffButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("1 pixel error"))
+                {
+                    lod1pxButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("2 pixel error"))
+                {
+                    lod2pxButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("4 pixel error"))
+                {
+                    lod4pxButtonDown->InvokeAllCallbacks();
+                }
+                ImGui::EndMenu();
+            }
+            if (loadingScene)
+            {
+                const char spinner[] = {'|', '/', '-', '\\'};
+                ImGui::SameLine(ImGui::GetWindowWidth() - 420);
+                ImGui::Text("Loading scene %c", spinner[static_cast<int>(ImGui::GetTime() * 8) % 4]);
+            }
+            ImGui::SameLine(ImGui::GetWindowWidth() - 260);
+            ImGui::Text(
+                "Scale: %d%%%s", static_cast<int>(renderScale * 100 + 0.5f), dynamicResolution ? " (auto)" : "");
             ImGui::SameLine(ImGui::GetWindowWidth() - 100);
 
             ImGui::Text("FPS: %s", std::to_string(fpsCounter).c_str());
@@ -104,11 +207,30 @@ namespace sage
     scene1ButtonDown(std::make_unique<Event>()), 
     scene2ButtonDown(std::make_unique<Event>()), 
     scene3ButtonDown(std::make_unique<Event>()),
+    scene4ButtonDown(std::make_unique<Event>()),
     quitButtonDown(std::make_unique<Event>()), 
     flatShaderButtonDown(std::make_unique<Event>()), 
     gouraudShaderButtonDown(std::make_unique<Event>()),
+    zPrepassButtonDown(std::make_unique<Event>()),
+    msaaButtonDown(std::make_unique<Event>()),
+    temporalButtonDown(std::make_unique<Event>()),
+    checkerboardButtonDown(std::make_unique<Event>()),
     bilinearButtonDown(std::make_unique<Event>()), 
-    neighbourButtonDown(std::make_unique<Event>())
+    neighbourButtonDown(std::make_unique<Event>()),
+    shadowsOffButtonDown(std::make_unique<Event>()),
+    hardShadowsButtonDown(std::make_unique<Event>()),
+    pcfShadowsButtonDown(std::make_unique<Event>()),
+    depth32FButtonDown(std::make_unique<Event>()),
+    depth24ButtonDown(std::make_unique<Event>()),
+    depth16ButtonDown(std::make_unique<Event>()),
+    renderScale50ButtonDown(std::make_unique<Event>()),
+    renderScale75ButtonDown(std::make_unique<Event>()),
+    renderScale100ButtonDown(std::make_unique<Event>()),
+    dynamicResolutionButtonDown(std::make_unique<Event>()),
+    lodOffButtonDown(std::make_unique<Event>()),
+    lod1pxButtonDown(std::make_unique<Event>()),
+    lod2pxButtonDown(std::make_unique<Event>()),
+    lod4pxButtonDown(std::make_unique<Event>())
     {
         init();
     }
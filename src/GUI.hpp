@@ -27,12 +27,34 @@ namespace sage
         std::unique_ptr<Event> scene1ButtonDown;
         std::unique_ptr<Event> scene2ButtonDown;
         std::unique_ptr<Event> scene3ButtonDown;
+        std::unique_ptr<Event> scene4ButtonDown;
         std::unique_ptr<Event> quitButtonDown;
         std::unique_ptr<Event> flatShaderButtonDown;
         std::unique_ptr<Event> gouraudShaderButtonDown;
+        std::unique_ptr<Event> zPrepassButtonDown;
+        std::unique_ptr<Event> msaaButtonDown;
+        std::unique_ptr<Event> temporalButtonDown;
+        std::unique_ptr<Event> checkerboardButtonDown;
         std::unique_ptr<Event> bilinearButtonDown;
         std::unique_ptr<Event> neighbourButtonDown;
+        std::unique_ptr<Event> shadowsOffButtonDown;
+        std::unique_ptr<Event> hardShadowsButtonDown;
+        std::unique_ptr<Event> pcfShadowsButtonDown;
+        std::unique_ptr<Event> depth32FButtonDown;
+        std::unique_ptr<Event> depth24ButtonDown;
+        std::unique_ptr<Event> depth16ButtonDown;
+        std::unique_ptr<Event> renderScale50ButtonDown;
+        std::unique_ptr<Event> renderScale75ButtonDown;
+        std::unique_ptr<Event> renderScale100ButtonDown;
+        std::unique_ptr<Event> dynamicResolutionButtonDown;
+        std::unique_ptr<Event> lodOffButtonDown;
+        std::unique_ptr<Event> lod1pxButtonDown;
+        std::unique_ptr<Event> lod2pxButtonDown;
+        std::unique_ptr<Event> lod4pxButtonDown;
         int fpsCounter = 0;
+        float renderScale = 1;
+        bool dynamicResolution = false;
+        bool loadingScene = false;
     };
 }
 
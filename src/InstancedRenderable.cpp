@@ -0,0 +1,56 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "InstancedRenderable.hpp"
+
+#include "smath.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sage
+{
+    void InstancedRenderable::Add(
+        const slib::vec3& position, const slib::vec3& _eulerAngles, const slib::vec3& scale)
+    {
+        positions.push_back(position);
+        eulerAngles.push_back(_eulerAngles);
+        scales.push_back(scale);
+
+        // Where the mesh's origin lands before the view transform, found the same way the renderer transforms
+        // vertices (the view matrix times the model matrix), with an identity view.
+        const slib::mat4 scaleMatrix = smath::scale(scale);
+        const slib::mat4 rotationMatrix = smath::rotation(_eulerAngles);
+        const slib::mat4 translationMatrix = smath::translation(position);
+        const slib::mat4 fullTransformMat = translationMatrix * (rotationMatrix * scaleMatrix);
+        const slib::vec4 origin = (smath::identity() * fullTransformMat) * slib::vec4(0, 0, 0, 1);
+        boundsX.push_back(origin.x);
+        boundsY.push_back(origin.y);
+        boundsZ.push_back(origin.z);
+        const float maxScale = std::max({std::abs(scale.x), std::abs(scale.y), std::abs(scale.z)});
+        boundsRadius.push_back(mesh->boundingRadius * maxScale);
+        ++version;
+    }
+
+    void InstancedRenderable::Clear()
+    {
+        positions.clear();
+        eulerAngles.clear();
+        scales.clear();
+        boundsX.clear();
+        boundsY.clear();
+        boundsZ.clear();
+        boundsRadius.clear();
+        ++version;
+    }
+
+    Renderable InstancedRenderable::Instance(std::size_t i) const
+    {
+        Renderable renderable(mesh, positions[i], eulerAngles[i], scales[i], col);
+        renderable.ignoreLighting = ignoreLighting;
+        renderable.atlas = atlas;
+        renderable.atlasTileSize = atlasTileSize;
+        return renderable;
+    }
+} // namespace sage
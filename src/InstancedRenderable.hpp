@@ -0,0 +1,70 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "Mesh.hpp"
+#include "Renderable.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace sage
+{
+    // One mesh drawn many times (vegetation, props) without copying it. Per-instance data is kept as separate
+    // arrays (structure of arrays) so that the renderer can cull every instance in one vectorised pass.
+    class InstancedRenderable
+    {
+        std::vector<slib::vec3> positions;
+        std::vector<slib::vec3> eulerAngles;
+        std::vector<slib::vec3> scales;
+        // Bounding sphere of each instance before the view transform
+        std::vector<float> boundsX, boundsY, boundsZ, boundsRadius;
+        unsigned int version = 0; // Changes with every Add and Clear
+
+      public:
+        const std::shared_ptr<const Mesh> mesh;
+        slib::Color col;
+        bool ignoreLighting = false;
+        bool atlas = false; // Does the mesh use a texture atlas (requires 'tiles' of a consistent size)
+        int atlasTileSize = 32;
+
+        InstancedRenderable(std::shared_ptr<const Mesh> _mesh, const slib::Color& _col)
+            : mesh(std::move(_mesh)), col(_col){};
+
+        void Add(const slib::vec3& position, const slib::vec3& _eulerAngles, const slib::vec3& scale);
+        void Clear();
+        std::size_t Count() const
+        {
+            return positions.size();
+        }
+        // Differs after any change to the instances, so that a renderer can tell a frame is out of date
+        unsigned int Version() const
+        {
+            return version;
+        }
+
+        // A lightweight renderable for one instance (it shares the mesh)
+        Renderable Instance(std::size_t i) const;
+
+        const float* BoundsX() const
+        {
+            return boundsX.data();
+        }
+        const float* BoundsY() const
+        {
+            return boundsY.data();
+        }
+        const float* BoundsZ() const
+        {
+            return boundsZ.data();
+        }
+        const float* BoundsRadius() const
+        {
+            return boundsRadius.data();
+        }
+    };
+} // namespace sage
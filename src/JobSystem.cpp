@@ -0,0 +1,206 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "JobSystem.hpp"
+
+#include <future>
+#include <iostream>
+#include <string>
+
+namespace sage
+{
+    namespace
+    {
+        // Which pool (if any) the current thread works for, and its queue there
+        thread_local const JobSystem* workerOf = nullptr;
+        thread_local std::size_t workerQueue = 0;
+    } // namespace
+
+    TaskGraph::Task TaskGraph::Add(std::function<void()> work, std::initializer_list<Task> dependsOn)
+    {
+        const Task task = nodes.size();
+        Node& node = nodes.emplace_back();
+        node.work = std::move(work);
+        node.dependencies = static_cast<int>(dependsOn.size());
+        for (const Task dependency : dependsOn)
+            nodes[dependency].dependents.push_back(task);
+        return task;
+    }
+
+    void TaskGraph::Run(JobSystem& jobs)
+    {
+        if (nodes.empty()) return;
+        unfinishedTasks = nodes.size();
+        for (auto& node : nodes)
+            node.unfinishedDependencies = node.dependencies;
+        for (std::size_t i = 0; i < nodes.size(); ++i)
+        {
+            if (nodes[i].dependencies == 0) jobs.push({&JobSystem::runTask, this, i, i + 1});
+        }
+        jobs.wait(unfinishedTasks, this);
+    }
+
+    void JobSystem::runTask(JobSystem& jobs, const Job& job)
+    {
+        auto& graph = *static_cast<TaskGraph*>(job.context);
+        auto& node = graph.nodes[job.begin];
+        node.work();
+        for (const auto dependent : node.dependents)
+        {
+            if (--graph.nodes[dependent].unfinishedDependencies == 0)
+                jobs.push({&JobSystem::runTask, &graph, dependent, dependent + 1});
+        }
+        --graph.unfinishedTasks;
+    }
+
+    std::size_t JobSystem::currentQueue() const
+    {
+        return workerOf == this ? workerQueue : 0;
+    }
+
+    void JobSystem::push(const Job& job)
+    {
+        Queue& queue = *queues[currentQueue()];
+        {
+            std::lock_guard lock(queue.mutex);
+            queue.jobs.push_back(job);
+        }
+        ++queuedJobs;
+        // Taking the lock orders this against a worker checking queuedJobs before it sleeps
+        {
+            std::lock_guard lock(sleepMutex);
+        }
+        jobAvailable.notify_one();
+    }
+
+    void JobSystem::pushPinned(std::size_t queue, const Job& job)
+    {
+        Queue& owner = *queues[queue];
+        {
+            std::lock_guard lock(owner.mutex);
+            owner.pinned.push_back(job);
+        }
+        ++owner.pinnedCount;
+        {
+            std::lock_guard lock(sleepMutex);
+        }
+        // Only the owner can run it, so everyone is woken to be sure it is
+        jobAvailable.notify_all();
+    }
+
+    bool JobSystem::runOne(std::size_t queue)
+    {
+        Job job{};
+        bool found = false;
+        bool pinned = false;
+        {
+            Queue& own = *queues[queue];
+            std::lock_guard lock(own.mutex);
+            if (queue != 0 && !own.pinned.empty())
+            {
+                job = own.pinned.pop_front();
+                found = pinned = true;
+            }
+            else if (!own.jobs.empty())
+            {
+                job = own.jobs.pop_back();
+                found = true;
+            }
+        }
+        for (std::size_t i = 1; !found && i < queues.size(); ++i)
+        {
+            Queue& victim = *queues[(queue + i) % queues.size()];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.jobs.empty())
+            {
+                job = victim.jobs.pop_front();
+                found = true;
+            }
+        }
+        if (!found) return false;
+        if (pinned)
+            --queues[queue]->pinnedCount;
+        else
+            --queuedJobs;
+        job.run(*this, job);
+        return true;
+    }
+
+    bool JobSystem::runOwn(const void* context)
+    {
+        Job job{};
+        {
+            Queue& shared = *queues[0];
+            std::lock_guard lock(shared.mutex);
+            if (!shared.jobs.take_last(context, job)) return false;
+        }
+        --queuedJobs;
+        job.run(*this, job);
+        return true;
+    }
+
+    void JobSystem::work(std::size_t queue)
+    {
+        workerOf = this;
+        workerQueue = queue;
+        while (!stopping)
+        {
+            if (runOne(queue)) continue;
+            std::unique_lock lock(sleepMutex);
+            jobAvailable.wait(
+                lock, [this, queue] { return stopping || queuedJobs > 0 || queues[queue]->pinnedCount > 0; });
+        }
+    }
+
+    void JobSystem::wait(const std::atomic<std::size_t>& counter, const void* context)
+    {
+        // Jobs split off on a worker go to that worker's deque, so a thread outside the pool may find none of its
+        // own left to help with and just waits for the workers to finish them.
+        const std::size_t queue = currentQueue();
+        while (counter != 0)
+        {
+            const bool ran = queue != 0 ? runOne(queue) : runOwn(context);
+            if (!ran) std::this_thread::yield();
+        }
+    }
+
+    JobSystem::JobSystem(const ThreadConfig& config)
+    {
+        const unsigned int threadCount = config.Resolve();
+        for (unsigned int i = 0; i < threadCount; ++i)
+            queues.push_back(std::make_unique<Queue>());
+        // Each worker pins itself and reports back, and any failures are printed together from here (lines
+        // printed by the workers themselves would interleave)
+        std::vector<std::future<bool>> pinned;
+        for (unsigned int i = 1; i < threadCount; ++i)
+        {
+            const int cpu = config.cpus.empty() ? -1 : config.cpus[i % config.cpus.size()];
+            std::promise<bool> pin;
+            pinned.push_back(pin.get_future());
+            workers.emplace_back([this, i, cpu, pin = std::move(pin)]() mutable {
+                pin.set_value(cpu < 0 || PinCurrentThread(cpu));
+                work(i);
+            });
+        }
+        std::string failed;
+        for (unsigned int i = 1; i < threadCount; ++i)
+        {
+            if (pinned[i - 1].get()) continue;
+            failed += " " + std::to_string(i) + " (CPU " +
+                      std::to_string(config.cpus[i % config.cpus.size()]) + ")";
+        }
+        if (!failed.empty()) std::cout << "Could not pin render threads:" << failed << std::endl;
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard lock(sleepMutex);
+            stopping = true;
+        }
+        jobAvailable.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+    }
+} // namespace sage
@@ -0,0 +1,250 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "ThreadConfig.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sage
+{
+    class JobSystem;
+
+    // Tasks with dependencies between them. A task starts once every task it depends on has finished; tasks
+    // with nothing between them run in parallel.
+    class TaskGraph
+    {
+        friend class JobSystem;
+
+        struct Node
+        {
+            std::function<void()> work;
+            std::vector<std::size_t> dependents;
+            int dependencies = 0;
+            std::atomic<int> unfinishedDependencies{0};
+        };
+        std::deque<Node> nodes; // A deque, so nodes (and their atomics) never move
+        std::atomic<std::size_t> unfinishedTasks{0};
+
+      public:
+        using Task = std::size_t;
+
+        Task Add(std::function<void()> work, std::initializer_list<Task> dependsOn = {});
+        // Runs every task and returns once they have all finished. The calling thread helps.
+        void Run(JobSystem& jobs);
+    };
+
+    // Work-stealing scheduler for the renderer's data parallel stages. Each worker owns a deque: it pushes and
+    // pops its own jobs at the back (newest first, which keeps its data in cache) and, when that runs dry,
+    // steals the oldest (largest) jobs from the front of someone else's. Threads outside the pool share one
+    // extra deque. While they wait they help with their own jobs only, so that one of them (presenting, say)
+    // never ends up running part of another's work (a frame rendering in the background).
+    class JobSystem
+    {
+        friend class TaskGraph;
+
+        struct Job
+        {
+            void (*run)(JobSystem& jobs, const Job& job);
+            void* context;
+            std::size_t begin, end;
+        };
+
+        // Double-ended ring of jobs that doubles when full and never shrinks, so once warmed up queueing a job
+        // doesn't allocate (a std::deque frees and reallocates blocks as it drains and refills).
+        class JobRing
+        {
+            std::vector<Job> slots;
+            std::size_t head = 0;
+            std::size_t count = 0;
+
+            std::size_t wrap(std::size_t i) const
+            {
+                return i & (slots.size() - 1);
+            }
+
+          public:
+            bool empty() const
+            {
+                return count == 0;
+            }
+
+            void push_back(const Job& job)
+            {
+                if (count == slots.size())
+                {
+                    std::vector<Job> grown(slots.empty() ? 64 : slots.size() * 2);
+                    for (std::size_t i = 0; i < count; ++i)
+                        grown[i] = slots[wrap(head + i)];
+                    slots.swap(grown);
+                    head = 0;
+                }
+                slots[wrap(head + count++)] = job;
+            }
+
+            Job pop_back()
+            {
+                return slots[wrap(head + --count)];
+            }
+
+            Job pop_front()
+            {
+                const Job job = slots[head];
+                head = wrap(head + 1);
+                --count;
+                return job;
+            }
+
+            // Removes the newest job with the given context, if there is one
+            bool take_last(const void* context, Job& job)
+            {
+                for (std::size_t i = count; i-- > 0;)
+                {
+                    if (slots[wrap(head + i)].context != context) continue;
+                    job = slots[wrap(head + i)];
+                    for (std::size_t j = i + 1; j < count; ++j)
+                        slots[wrap(head + j - 1)] = slots[wrap(head + j)];
+                    --count;
+                    return true;
+                }
+                return false;
+            }
+        };
+
+        struct Queue
+        {
+            std::mutex mutex;
+            JobRing jobs;
+            JobRing pinned; // Only the owner runs these (see RunOnEachThread)
+            std::atomic<int> pinnedCount{0};
+        };
+
+        // Queue 0 is for threads outside the pool, then one per worker
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<int> queuedJobs{0}; // Stealable jobs, not counting pinned ones
+        std::mutex sleepMutex;
+        std::condition_variable jobAvailable;
+        std::atomic<bool> stopping{false};
+
+        std::size_t currentQueue() const;
+        void push(const Job& job);
+        void pushPinned(std::size_t queue, const Job& job);
+        bool runOne(std::size_t queue);
+        bool runOwn(const void* context);
+        void work(std::size_t queue);
+        // Returns once counter reaches zero. Workers run any jobs meanwhile; other threads only context's.
+        void wait(const std::atomic<std::size_t>& counter, const void* context);
+        static void runTask(JobSystem& jobs, const Job& job);
+
+        template <typename F>
+        struct ForContext
+        {
+            const F& body;
+            std::size_t grain;
+            std::atomic<std::size_t> remaining;
+        };
+
+        // Splits the range in half, queueing the upper half, until it's no bigger than the grain, then runs it
+        template <typename F>
+        static void runRange(JobSystem& jobs, const Job& job)
+        {
+            auto& context = *static_cast<ForContext<F>*>(job.context);
+            std::size_t end = job.end;
+            while (end - job.begin > context.grain)
+            {
+                const std::size_t middle = job.begin + (end - job.begin) / 2;
+                jobs.push({&runRange<F>, job.context, middle, end});
+                end = middle;
+            }
+            context.body(job.begin, end);
+            context.remaining -= end - job.begin;
+        }
+
+        template <typename F>
+        struct EachContext
+        {
+            const F& body;
+            std::atomic<std::size_t> remaining;
+        };
+
+        template <typename F>
+        static void runEach(JobSystem& jobs, const Job& job)
+        {
+            auto& context = *static_cast<EachContext<F>*>(job.context);
+            context.body(static_cast<unsigned int>(job.begin), jobs.BandCount());
+            --context.remaining;
+        }
+
+      public:
+        // The thread calling ParallelFor or TaskGraph::Run counts as one of config's threads.
+        // The rest are workers, pinned to config's CPUs if it lists any.
+        explicit JobSystem(const ThreadConfig& config = {});
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+        ~JobSystem();
+
+        // Including the calling thread
+        unsigned int ThreadCount() const
+        {
+            return static_cast<unsigned int>(workers.size()) + 1;
+        }
+
+        // The calling thread's index in [0, ThreadCount()): its worker number, or 0 for threads outside the pool
+        unsigned int ThreadIndex() const
+        {
+            return static_cast<unsigned int>(currentQueue());
+        }
+
+        // Calls body(begin, end) over sub-ranges of [0, count) of at most grain items each, and returns once
+        // all of them have run. Small grains balance uneven work (such as triangles of very different sizes)
+        // better, at the cost of more scheduling.
+        template <typename F>
+        void ParallelFor(std::size_t count, std::size_t grain, const F& body)
+        {
+            if (count == 0) return;
+            grain = grain == 0 ? 1 : grain;
+            if (count <= grain || workers.empty())
+            {
+                body(std::size_t{0}, count);
+                return;
+            }
+            ForContext<F> context{body, grain, {count}};
+            runRange<F>(*this, {&runRange<F>, &context, 0, count});
+            wait(context.remaining, &context);
+        }
+
+        // Calls body(band, BandCount()) once for each band: on worker band + 1, or on the caller when there are
+        // no workers. Splitting a buffer into bands this way touches each part from the same worker (and so, when
+        // pinned, the same core and memory node) every time, whichever thread asks.
+        template <typename F>
+        void RunOnEachThread(const F& body)
+        {
+            if (workers.empty())
+            {
+                body(0u, 1u);
+                return;
+            }
+            EachContext<F> context{body, {workers.size()}};
+            for (std::size_t worker = 1; worker < queues.size(); ++worker)
+                pushPinned(worker, {&runEach<F>, &context, worker - 1, worker});
+            wait(context.remaining, &context);
+        }
+
+        // How many bands RunOnEachThread splits work into
+        unsigned int BandCount() const
+        {
+            return workers.empty() ? 1 : static_cast<unsigned int>(workers.size());
+        }
+    };
+} // namespace sage
@@ -0,0 +1,72 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "slib.hpp"
+
+namespace sage
+{
+    enum LightType
+    {
+        DIRECTIONAL,
+        POINT,
+        SPOT
+    };
+
+    struct Light
+    {
+        LightType type = POINT;
+        slib::vec3 position{};
+        // Directional: points towards the light (its length scales the light, like the old lightingDirection).
+        // Spot: the direction the cone faces.
+        slib::vec3 direction{0, -1, 0};
+        slib::vec3 color{1, 1, 1};
+        float intensity = 1;
+        float range = 10; // Point/spot contribution falls to zero at this distance
+        // Cosines of the spot cone's half-angles (full intensity inside inner, none outside outer)
+        float innerCone = 0.9f;
+        float outerCone = 0.8f;
+        bool castsShadows = true; // Only the first shadow casting directional light is used
+
+        bool operator==(const Light&) const = default;
+
+        static Light Directional(const slib::vec3& direction, const slib::vec3& color = {1, 1, 1})
+        {
+            Light light;
+            light.type = DIRECTIONAL;
+            light.direction = direction;
+            light.color = color;
+            return light;
+        }
+
+        static Light Point(const slib::vec3& position, const slib::vec3& color, float intensity, float range)
+        {
+            Light light;
+            light.type = POINT;
+            light.position = position;
+            light.color = color;
+            light.intensity = intensity;
+            light.range = range;
+            return light;
+        }
+
+        static Light Spot(
+            const slib::vec3& position,
+            const slib::vec3& direction,
+            const slib::vec3& color,
+            float intensity,
+            float range,
+            float innerCone,
+            float outerCone)
+        {
+            Light light = Point(position, color, intensity, range);
+            light.type = SPOT;
+            light.direction = direction;
+            light.innerCone = innerCone;
+            light.outerCone = outerCone;
+            return light;
+        }
+    };
+} // namespace sage
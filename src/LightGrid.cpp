@@ -0,0 +1,133 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "LightGrid.hpp"
+
+#include "smath.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sage
+{
+    struct TileRect
+    {
+        int x0, y0, x1, y1; // Inclusive tile bounds
+    };
+
+    // Project the corners of the light's view-space bounding box and take their screen-space extents.
+    // Returns false if the light cannot affect anything on screen.
+    inline bool lightScreenRect(
+        const Light& light,
+        const slib::mat4& viewMatrix,
+        const slib::mat4& perspectiveMat,
+        int width,
+        int height,
+        int tileSize,
+        TileRect& rect)
+    {
+        const slib::vec4 center = viewMatrix * slib::vec4(light.position, 1);
+        const float r = light.range;
+
+        float xmin = static_cast<float>(width), ymin = static_cast<float>(height);
+        float xmax = 0, ymax = 0;
+        int behind = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            const slib::vec4 corner(
+                center.x + (i & 1 ? r : -r), center.y + (i & 2 ? r : -r), center.z + (i & 4 ? r : -r), 1);
+            const slib::vec4 clip = perspectiveMat * corner;
+            if (clip.w <= 0)
+            {
+                ++behind;
+                continue;
+            }
+            const float sx = width / 2.0f + clip.x / clip.w * width / 2.0f;
+            const float sy = height / 2.0f - clip.y / clip.w * height / 2.0f;
+            xmin = std::min(xmin, sx);
+            xmax = std::max(xmax, sx);
+            ymin = std::min(ymin, sy);
+            ymax = std::max(ymax, sy);
+        }
+
+        if (behind == 8) return false;
+        if (behind > 0)
+        {
+            // The sphere straddles the camera plane; its projection is unbounded.
+            xmin = ymin = 0;
+            xmax = static_cast<float>(width);
+            ymax = static_cast<float>(height);
+        }
+        if (xmax < 0 || ymax < 0 || xmin >= width || ymin >= height) return false;
+
+        const int tilesX = (width + tileSize - 1) / tileSize;
+        const int tilesY = (height + tileSize - 1) / tileSize;
+        rect.x0 = std::clamp(static_cast<int>(xmin) / tileSize, 0, tilesX - 1);
+        rect.x1 = std::clamp(static_cast<int>(xmax) / tileSize, 0, tilesX - 1);
+        rect.y0 = std::clamp(static_cast<int>(ymin) / tileSize, 0, tilesY - 1);
+        rect.y1 = std::clamp(static_cast<int>(ymax) / tileSize, 0, tilesY - 1);
+        return true;
+    }
+
+    void LightGrid::Build(
+        const std::vector<const Light*>& lights,
+        const slib::mat4& viewMatrix,
+        const slib::mat4& perspectiveMat,
+        int width,
+        int height,
+        FrameArena& arena)
+    {
+        tilesX = (width + tileSize - 1) / tileSize;
+        tilesY = (height + tileSize - 1) / tileSize;
+        const int tileCount = tilesX * tilesY;
+
+        directionalLights.clear();
+        shadowCaster = -1;
+        localLights.clear();
+        const auto rects = arena.Allocate<TileRect>(lights.size());
+        std::size_t rectCount = 0;
+        for (const auto* light : lights)
+        {
+            if (light->type == DIRECTIONAL)
+            {
+                if (shadowCaster < 0 && light->castsShadows)
+                    shadowCaster = static_cast<int>(directionalLights.size());
+                directionalLights.push_back(*light);
+                continue;
+            }
+            TileRect rect{};
+            if (!lightScreenRect(*light, viewMatrix, perspectiveMat, width, height, tileSize, rect)) continue;
+            localLights.push_back(*light);
+            if (light->type == SPOT) localLights.back().direction = smath::normalize(light->direction);
+            rects[rectCount++] = rect;
+        }
+
+        // Count the lights per tile, prefix sum into offsets, then scatter the indices.
+        tileOffsets.assign(tileCount + 1, 0);
+        for (const auto& rect : rects.first(rectCount))
+        {
+            for (int ty = rect.y0; ty <= rect.y1; ++ty)
+                for (int tx = rect.x0; tx <= rect.x1; ++tx)
+                    ++tileOffsets[ty * tilesX + tx + 1];
+        }
+        for (int i = 0; i < tileCount; ++i)
+            tileOffsets[i + 1] += tileOffsets[i];
+
+        tileIndices.resize(tileOffsets[tileCount]);
+        const auto cursor = arena.Allocate<unsigned int>(tileCount);
+        std::copy(tileOffsets.begin(), tileOffsets.end() - 1, cursor.begin());
+        for (size_t i = 0; i < rectCount; ++i)
+        {
+            const auto& rect = rects[i];
+            for (int ty = rect.y0; ty <= rect.y1; ++ty)
+                for (int tx = rect.x0; tx <= rect.x1; ++tx)
+                    tileIndices[cursor[ty * tilesX + tx]++] = static_cast<unsigned short>(i);
+        }
+    }
+
+    const Light* LightGrid::ShadowCaster() const
+    {
+        return shadowCaster < 0 ? nullptr : &directionalLights[shadowCaster];
+    }
+} // namespace sage
@@ -0,0 +1,93 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "FrameArena.hpp"
+#include "Light.hpp"
+#include "slib.hpp"
+#include "smath.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace sage
+{
+    inline slib::vec3 evaluateLight(const Light& light, const slib::vec3& pos, const slib::vec3& normal)
+    {
+        if (light.type == DIRECTIONAL)
+        {
+            return light.color * (std::max(0.0f, smath::dot(normal, light.direction)) * light.intensity);
+        }
+
+        slib::vec3 toLight = light.position - pos;
+        const float dist2 = smath::dot(toLight, toLight);
+        const float range2 = light.range * light.range;
+        if (dist2 >= range2) return {0, 0, 0};
+
+        toLight /= std::sqrt(dist2);
+        const float nDotL = smath::dot(normal, toLight);
+        if (nDotL <= 0) return {0, 0, 0};
+
+        float falloff = 1 - dist2 / range2;
+        falloff *= falloff;
+        if (light.type == SPOT)
+        {
+            const float cosAngle = -smath::dot(toLight, light.direction);
+            falloff *= std::clamp((cosAngle - light.outerCone) / (light.innerCone - light.outerCone), 0.0f, 1.0f);
+        }
+        return light.color * (nDotL * falloff * light.intensity);
+    }
+
+    // Forward+ style light culling. The screen is split into fixed-size tiles and each point/spot light is
+    // binned into the tiles its bounding sphere covers, so a pixel only evaluates the lights that can reach it.
+    class LightGrid
+    {
+        static constexpr int tileSize = 16;
+        int tilesX = 0;
+        int tilesY = 0;
+        // Directional lights affect every pixel, so they are never binned
+        std::vector<Light> directionalLights;
+        int shadowCaster = -1; // Index into directionalLights
+        // Point/spot lights that survived culling
+        std::vector<Light> localLights;
+        // tileIndices[tileOffsets[i], tileOffsets[i + 1]) are the indices into localLights for tile i
+        std::vector<unsigned int> tileOffsets;
+        std::vector<unsigned short> tileIndices;
+
+      public:
+        // Scratch space comes from arena
+        void Build(
+            const std::vector<const Light*>& lights,
+            const slib::mat4& viewMatrix,
+            const slib::mat4& perspectiveMat,
+            int width,
+            int height,
+            FrameArena& arena);
+        // The directional light that shadows are cast from, or nullptr.
+        const Light* ShadowCaster() const;
+        // Sum of the light arriving at a world-space point with the given (normalised) normal, using only the
+        // lights binned into the tile containing screen pixel (x, y). The shadow caster's contribution is scaled
+        // by shadow (0 = fully shadowed).
+        slib::vec3 Illuminate(
+            int x, int y, const slib::vec3& pos, const slib::vec3& normal, float shadow = 1) const;
+    };
+
+    inline slib::vec3 LightGrid::Illuminate(
+        int x, int y, const slib::vec3& pos, const slib::vec3& normal, float shadow) const
+    {
+        slib::vec3 lum{0, 0, 0};
+        for (int i = 0; i < static_cast<int>(directionalLights.size()); ++i)
+        {
+            const auto light = evaluateLight(directionalLights[i], pos, normal);
+            lum += i == shadowCaster ? light * shadow : light;
+        }
+
+        const int tile = (y / tileSize) * tilesX + x / tileSize;
+        for (unsigned int i = tileOffsets[tile]; i < tileOffsets[tile + 1]; ++i)
+            lum += evaluateLight(localLights[tileIndices[i]], pos, normal);
+        return lum;
+    }
+} // namespace sage
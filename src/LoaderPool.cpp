@@ -0,0 +1,52 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "LoaderPool.hpp"
+
+#include <algorithm>
+#include <omp.h>
+
+namespace sage
+{
+    void LoaderPool::work()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock lock(mutex);
+                jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    LoaderPool::LoaderPool(unsigned int threadCount, unsigned int ompThreads)
+    {
+        for (unsigned int i = 0; i < std::max(threadCount, 1u); ++i)
+        {
+            workers.emplace_back([this, ompThreads] {
+                if (ompThreads > 0) omp_set_num_threads(static_cast<int>(ompThreads));
+                work();
+            });
+        }
+    }
+
+    LoaderPool::~LoaderPool()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+            jobs.clear();
+        }
+        jobAvailable.notify_all();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+} // namespace sage
@@ -0,0 +1,55 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace sage
+{
+    // A few background threads for slow, blocking jobs such as loading scenes. Each submitted job returns a
+    // future for its result. Jobs still queued when the pool is destroyed are dropped (their futures report
+    // broken_promise); jobs already running are finished first.
+    //
+    // OpenMP's thread count is per thread, so one set elsewhere doesn't reach these threads. ompThreads, if
+    // given, is set on each of them as it starts and so limits the OpenMP regions its jobs run (model parsing).
+    // 0 leaves OpenMP's default.
+    class LoaderPool
+    {
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable jobAvailable;
+        bool stopping = false;
+        void work();
+
+      public:
+        explicit LoaderPool(unsigned int threadCount = 1, unsigned int ompThreads = 0);
+        LoaderPool(const LoaderPool&) = delete;
+        LoaderPool& operator=(const LoaderPool&) = delete;
+        ~LoaderPool();
+
+        template <typename F>
+        std::future<std::invoke_result_t<F>> Submit(F job)
+        {
+            // std::function needs a copyable target, so the (move-only) task is shared
+            auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::move(job));
+            auto result = task->get_future();
+            {
+                std::lock_guard lock(mutex);
+                jobs.emplace_back([task] { (*task)(); });
+            }
+            jobAvailable.notify_one();
+            return result;
+        }
+    };
+} // namespace sage
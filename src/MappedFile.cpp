@@ -0,0 +1,104 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sage
+{
+    // Mapping zero bytes is an error on both platforms, so empty files are given a non-null, zero length view.
+    static const char emptyFile[1] = {};
+
+#ifdef _WIN32
+    MappedFile::MappedFile(const char* path)
+    {
+        HANDLE file = CreateFileA(
+            path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+        fileHandle = file;
+
+        LARGE_INTEGER fileSize{};
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart == 0)
+        {
+            ptr = emptyFile;
+        }
+        else if (fileSize.QuadPart > 0)
+        {
+            mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mappingHandle)
+                ptr = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (!ptr)
+        {
+            close();
+            return;
+        }
+        length = ptr == emptyFile ? 0 : static_cast<std::size_t>(fileSize.QuadPart);
+    }
+
+    void MappedFile::close()
+    {
+        if (ptr && ptr != emptyFile) UnmapViewOfFile(ptr);
+        if (mappingHandle) CloseHandle(mappingHandle);
+        if (fileHandle) CloseHandle(fileHandle);
+        ptr = nullptr;
+        length = 0;
+        mappingHandle = fileHandle = nullptr;
+    }
+#else
+    MappedFile::MappedFile(const char* path)
+    {
+        const int fd = open(path, O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat info{};
+        if (fstat(fd, &info) == 0)
+        {
+            if (info.st_size == 0)
+            {
+                ptr = emptyFile;
+            }
+            else
+            {
+                void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED)
+                {
+                    // The file is scanned front to back once
+                    madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+                    ptr = static_cast<const char*>(mapped);
+                    length = static_cast<std::size_t>(info.st_size);
+                }
+            }
+        }
+        // The mapping stays valid after the descriptor is closed
+        ::close(fd);
+    }
+
+    void MappedFile::close()
+    {
+        if (ptr && ptr != emptyFile) munmap(const_cast<char*>(ptr), length);
+        ptr = nullptr;
+        length = 0;
+    }
+#endif
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    bool MappedFile::IsOpen() const
+    {
+        return ptr != nullptr;
+    }
+} // namespace sage
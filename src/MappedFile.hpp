@@ -0,0 +1,45 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace sage
+{
+    // Read-only memory mapping of a whole file. The contents are paged in by the OS on demand rather than copied
+    // into a buffer up front.
+    class MappedFile
+    {
+        const char* ptr = nullptr;
+        std::size_t length = 0;
+#ifdef _WIN32
+        void* fileHandle = nullptr;
+        void* mappingHandle = nullptr;
+#endif
+        void close();
+
+      public:
+        explicit MappedFile(const char* path);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        // False if the file could not be opened. An empty file is open but has no data.
+        bool IsOpen() const;
+        const char* Data() const
+        {
+            return ptr;
+        }
+        std::size_t Size() const
+        {
+            return length;
+        }
+        std::string_view View() const
+        {
+            return {ptr, length};
+        }
+    };
+} // namespace sage
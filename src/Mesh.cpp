@@ -0,0 +1,350 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "Mesh.hpp"
+
+#include <cfloat>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace sage
+{
+    namespace
+    {
+        std::uint16_t quantize(float value, float offset, float scale)
+        {
+            if (scale == 0) return 0;
+            return static_cast<std::uint16_t>(std::clamp(std::lround((value - offset) / scale), 0L, 65535L));
+        }
+
+        std::int16_t quantizeSigned(float value)
+        {
+            return static_cast<std::int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+        }
+
+        struct PackedVertexHash
+        {
+            std::size_t operator()(const PackedVertex& v) const
+            {
+                std::size_t hash = 14695981039346656037ull;
+                const auto* bytes = reinterpret_cast<const unsigned char*>(&v);
+                for (std::size_t i = 0; i < sizeof(PackedVertex); ++i)
+                    hash = (hash ^ bytes[i]) * 1099511628211ull;
+                return hash;
+            }
+        };
+
+        struct PackedVertexEqual
+        {
+            bool operator()(const PackedVertex& a, const PackedVertex& b) const
+            {
+                return std::memcmp(&a, &b, sizeof(PackedVertex)) == 0;
+            }
+        };
+
+        // Interleaves the low 10 bits of x, y and z
+        std::uint32_t mortonCode(std::uint32_t x, std::uint32_t y, std::uint32_t z)
+        {
+            auto spread = [](std::uint32_t v) {
+                v &= 0x3ff;
+                v = (v | (v << 16)) & 0x030000ff;
+                v = (v | (v << 8)) & 0x0300f00f;
+                v = (v | (v << 4)) & 0x030c30c3;
+                v = (v | (v << 2)) & 0x09249249;
+                return v;
+            };
+            return spread(x) | (spread(y) << 1) | (spread(z) << 2);
+        }
+
+        // Triangles sorted along a Z-order curve through their centroids, so neighbours in the list are
+        // neighbours in space (and so, mostly, on screen).
+        std::vector<std::uint32_t> spatialOrder(const MeshGeometry& geometry)
+        {
+            const std::size_t triangleCount = geometry.TriangleCount();
+            std::vector<std::uint32_t> codes(triangleCount);
+            for (std::size_t t = 0; t < triangleCount; ++t)
+            {
+                std::uint32_t centroid[3] = {0, 0, 0};
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    const auto& position = geometry.vertices[geometry.indices[t * 3 + corner]].position;
+                    for (int axis = 0; axis < 3; ++axis)
+                        centroid[axis] += position[axis];
+                }
+                // Positions span the 16-bit range, so the top 10 bits of each coordinate's mean
+                codes[t] = mortonCode(centroid[0] / 3 >> 6, centroid[1] / 3 >> 6, centroid[2] / 3 >> 6);
+            }
+            std::vector<std::uint32_t> order(triangleCount);
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&codes](auto a, auto b) { return codes[a] < codes[b]; });
+            return order;
+        }
+
+        // Tom Forsyth's "Linear-Speed Vertex Cache Optimisation": greedily emits the triangle whose vertices
+        // score best, where a vertex scores for being recently used (in a simulated LRU cache) and for having
+        // few triangles left (so that none are stranded). Triangles are taken from the input order, which is
+        // spatialOrder, and when the cache has nothing left to offer the next triangle along the curve is taken.
+        class VertexCacheOptimizer
+        {
+            static constexpr int cacheSize = 32;
+            static constexpr float cacheDecayPower = 1.5f;
+            static constexpr float lastTriangleScore = 0.75f;
+            static constexpr float valenceBoostScale = 2.0f;
+            static constexpr float valenceBoostPower = 0.5f;
+
+            const std::vector<std::uint32_t>& indices; // Three per triangle, in the input order
+            std::vector<std::uint32_t> vertexTriangles;   // Each vertex's unemitted triangles, from triangleStart
+            std::vector<std::uint32_t> triangleStart;     // Per vertex
+            std::vector<std::uint32_t> remaining;         // Per vertex, its number of unemitted triangles
+            std::vector<int> cachePosition;               // Per vertex, -1 when not in the cache
+            std::vector<float> vertexScore;
+            std::vector<float> triangleScore;
+            std::vector<bool> emitted;
+            std::vector<std::uint32_t> cache;
+
+            float scoreVertex(std::uint32_t v) const
+            {
+                if (remaining[v] == 0) return -1;
+                float score = 0;
+                const int position = cachePosition[v];
+                if (position >= 0)
+                {
+                    // The last triangle's vertices score the same regardless of their order, so that the
+                    // triangle just emitted isn't favoured over its neighbours
+                    if (position < 3)
+                        score = lastTriangleScore;
+                    else
+                        score = std::pow(
+                            1.0f - static_cast<float>(position - 3) / (cacheSize - 3), cacheDecayPower);
+                }
+                return score + valenceBoostScale * std::pow(static_cast<float>(remaining[v]), -valenceBoostPower);
+            }
+
+          public:
+            VertexCacheOptimizer(const std::vector<std::uint32_t>& _indices, std::size_t vertexCount) :
+                indices(_indices),
+                triangleStart(vertexCount + 1, 0),
+                remaining(vertexCount, 0),
+                cachePosition(vertexCount, -1),
+                vertexScore(vertexCount),
+                triangleScore(indices.size() / 3, 0),
+                emitted(indices.size() / 3, false)
+            {
+                for (const auto v : indices)
+                    ++remaining[v];
+                for (std::size_t v = 0; v < vertexCount; ++v)
+                    triangleStart[v + 1] = triangleStart[v] + remaining[v];
+                vertexTriangles.resize(indices.size());
+                std::vector<std::uint32_t> fill(triangleStart.begin(), triangleStart.end() - 1);
+                for (std::size_t i = 0; i < indices.size(); ++i)
+                    vertexTriangles[fill[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+                for (std::size_t v = 0; v < vertexCount; ++v)
+                    vertexScore[v] = scoreVertex(static_cast<std::uint32_t>(v));
+                for (std::size_t i = 0; i < indices.size(); ++i)
+                    triangleScore[i / 3] += vertexScore[indices[i]];
+            }
+
+            // Triangles of the input, in the order to draw them
+            std::vector<std::uint32_t> Run()
+            {
+                const std::size_t triangleCount = triangleScore.size();
+                std::vector<std::uint32_t> order;
+                order.reserve(triangleCount);
+                std::size_t cursor = 0; // Next triangle along the input order that may not have been emitted
+                std::int64_t best = -1;
+                while (order.size() < triangleCount)
+                {
+                    if (best < 0)
+                    {
+                        while (emitted[cursor])
+                            ++cursor;
+                        best = static_cast<std::int64_t>(cursor);
+                    }
+                    const auto triangle = static_cast<std::uint32_t>(best);
+                    order.push_back(triangle);
+                    best = emit(triangle);
+                }
+                return order;
+            }
+
+          private:
+            // Returns the best scoring triangle with a vertex in the cache, or -1 if there is none
+            std::int64_t emit(std::uint32_t triangle)
+            {
+                emitted[triangle] = true;
+                const std::uint32_t* corners = &indices[triangle * 3];
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    // Drop the triangle from the vertex's list of unemitted ones
+                    const std::uint32_t v = corners[corner];
+                    auto* first = &vertexTriangles[triangleStart[v]];
+                    auto* last = first + remaining[v];
+                    std::iter_swap(std::find(first, last, triangle), last - 1);
+                    --remaining[v];
+                }
+
+                // Move the triangle's vertices to the front of the cache; whatever falls off the end is evicted
+                std::vector<std::uint32_t> updated(corners, corners + 3);
+                for (const auto v : cache)
+                {
+                    if (v != corners[0] && v != corners[1] && v != corners[2]) updated.push_back(v);
+                }
+                for (std::size_t i = cacheSize; i < updated.size(); ++i)
+                    cachePosition[updated[i]] = -1;
+                if (updated.size() > cacheSize) updated.resize(cacheSize);
+                for (std::size_t i = 0; i < updated.size(); ++i)
+                    cachePosition[updated[i]] = static_cast<int>(i);
+
+                // Rescore the vertices whose position changed, and with them their triangles
+                auto rescore = [this](std::uint32_t v) {
+                    const float score = scoreVertex(v);
+                    const float delta = score - vertexScore[v];
+                    vertexScore[v] = score;
+                    for (std::uint32_t i = 0; i < remaining[v]; ++i)
+                        triangleScore[vertexTriangles[triangleStart[v] + i]] += delta;
+                };
+                for (const auto v : cache)
+                {
+                    if (cachePosition[v] < 0) rescore(v);
+                }
+                cache.swap(updated);
+                std::int64_t best = -1;
+                float bestScore = -1;
+                for (const auto v : cache)
+                {
+                    rescore(v);
+                    for (std::uint32_t i = 0; i < remaining[v]; ++i)
+                    {
+                        const auto t = vertexTriangles[triangleStart[v] + i];
+                        if (triangleScore[t] > bestScore)
+                        {
+                            bestScore = triangleScore[t];
+                            best = t;
+                        }
+                    }
+                }
+                return best;
+            }
+        };
+    } // namespace
+
+    VertexQuantization VertexQuantization::Fit(const std::vector<slib::tri>& faces)
+    {
+        slib::vec3 minPosition{FLT_MAX, FLT_MAX, FLT_MAX}, maxPosition{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+        slib::vec2 minTexture{FLT_MAX, FLT_MAX}, maxTexture{-FLT_MAX, -FLT_MAX};
+        for (const auto& f : faces)
+        {
+            for (const auto* v : {&f.v1, &f.v2, &f.v3})
+            {
+                minPosition = {
+                    std::min(minPosition.x, v->position.x),
+                    std::min(minPosition.y, v->position.y),
+                    std::min(minPosition.z, v->position.z)};
+                maxPosition = {
+                    std::max(maxPosition.x, v->position.x),
+                    std::max(maxPosition.y, v->position.y),
+                    std::max(maxPosition.z, v->position.z)};
+                const auto& uv = v->textureCoords;
+                minTexture = {std::min(minTexture.x, uv.x), std::min(minTexture.y, uv.y)};
+                maxTexture = {std::max(maxTexture.x, uv.x), std::max(maxTexture.y, uv.y)};
+            }
+        }
+
+        VertexQuantization quantization;
+        if (faces.empty()) return quantization;
+        quantization.positionOffset = minPosition;
+        quantization.positionScale = (maxPosition - minPosition) / 65535.0f;
+        quantization.textureOffset = minTexture;
+        quantization.textureScale = {
+            (maxTexture.x - minTexture.x) / 65535.0f, (maxTexture.y - minTexture.y) / 65535.0f};
+        return quantization;
+    }
+
+    PackedVertex VertexQuantization::Encode(const slib::vertex& v) const
+    {
+        PackedVertex packed{};
+        packed.position[0] = quantize(v.position.x, positionOffset.x, positionScale.x);
+        packed.position[1] = quantize(v.position.y, positionOffset.y, positionScale.y);
+        packed.position[2] = quantize(v.position.z, positionOffset.z, positionScale.z);
+        packed.textureCoords[0] = quantize(v.textureCoords.x, textureOffset.x, textureScale.x);
+        packed.textureCoords[1] = quantize(v.textureCoords.y, textureOffset.y, textureScale.y);
+
+        // Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the upper half's square
+        const auto& n = v.normal;
+        const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if (l1 == 0) return packed; // No normal; decodes as +z
+        float x = n.x / l1;
+        float y = n.y / l1;
+        if (n.z < 0)
+        {
+            const float foldedX = (1 - std::abs(y)) * (x >= 0 ? 1.0f : -1.0f);
+            const float foldedY = (1 - std::abs(x)) * (y >= 0 ? 1.0f : -1.0f);
+            x = foldedX;
+            y = foldedY;
+        }
+        packed.normal[0] = quantizeSigned(x);
+        packed.normal[1] = quantizeSigned(y);
+        return packed;
+    }
+
+    MeshGeometry MeshGeometry::Pack(const std::vector<slib::tri>& faces, const VertexQuantization& quantization)
+    {
+        MeshGeometry geometry;
+        std::unordered_map<PackedVertex, std::uint32_t, PackedVertexHash, PackedVertexEqual> vertexIndex;
+        geometry.indices.reserve(faces.size() * 3);
+        geometry.materials.reserve(faces.size());
+        for (const auto& face : faces)
+        {
+            for (const slib::vertex* v : {&face.v1, &face.v2, &face.v3})
+            {
+                const PackedVertex packed = quantization.Encode(*v);
+                const auto [it, inserted] =
+                    vertexIndex.try_emplace(packed, static_cast<std::uint32_t>(geometry.vertices.size()));
+                if (inserted) geometry.vertices.push_back(packed);
+                geometry.indices.push_back(it->second);
+            }
+            geometry.materials.push_back(static_cast<std::int16_t>(face.material));
+        }
+        geometry.Optimize();
+        return geometry;
+    }
+
+    void MeshGeometry::Optimize()
+    {
+        // Spatially coherent triangles, reordered for vertex reuse
+        const auto spatial = spatialOrder(*this);
+        std::vector<std::uint32_t> spatialIndices(indices.size());
+        for (std::size_t t = 0; t < spatial.size(); ++t)
+            std::copy_n(&indices[spatial[t] * 3], 3, &spatialIndices[t * 3]);
+        const auto cacheOrder = VertexCacheOptimizer(spatialIndices, vertices.size()).Run();
+
+        std::vector<std::uint32_t> orderedIndices(indices.size());
+        std::vector<std::int16_t> orderedMaterials(materials.size());
+        for (std::size_t t = 0; t < cacheOrder.size(); ++t)
+        {
+            std::copy_n(&spatialIndices[cacheOrder[t] * 3], 3, &orderedIndices[t * 3]);
+            orderedMaterials[t] = materials[spatial[cacheOrder[t]]];
+        }
+
+        // Vertices in the order the triangles first use them
+        constexpr auto unassigned = static_cast<std::uint32_t>(-1);
+        std::vector<std::uint32_t> remap(vertices.size(), unassigned);
+        std::vector<PackedVertex> orderedVertices;
+        orderedVertices.reserve(vertices.size());
+        for (auto& index : orderedIndices)
+        {
+            if (remap[index] == unassigned)
+            {
+                remap[index] = static_cast<std::uint32_t>(orderedVertices.size());
+                orderedVertices.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+
+        vertices = std::move(orderedVertices);
+        indices = std::move(orderedIndices);
+        materials = std::move(orderedMaterials);
+    }
+} // namespace sage
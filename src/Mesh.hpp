@@ -2,26 +2,121 @@
 // Created by Steve Wheeler on 23/08/2023.
 //
 #pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <utility>
 #include <vector>
-#include <map>
 #include <glm/glm.hpp>
 #include "slib.hpp"
 #include <string>
 
 namespace sage
 {
+// A vertex as a mesh stores it: 14 bytes, against 32 for the floats it was loaded as. The position is 16-bit
+// within the mesh's bounding box and the texture coordinates 16-bit within the range the mesh uses (see
+// VertexQuantization); the normal is octahedral encoded, a unit vector folded onto two 16-bit values.
+struct PackedVertex
+{
+    std::uint16_t position[3];
+    std::uint16_t textureCoords[2];
+    std::int16_t normal[2];
+};
+
+// Maps a PackedVertex's quantised values back to floats: offset + value * scale
+struct VertexQuantization
+{
+    slib::vec3 positionOffset{0, 0, 0};
+    slib::vec3 positionScale{0, 0, 0};
+    slib::vec2 textureOffset{0, 0};
+    slib::vec2 textureScale{0, 0};
+
+    // Fits the ranges to every vertex of faces
+    static VertexQuantization Fit(const std::vector<slib::tri>& faces);
+    PackedVertex Encode(const slib::vertex& v) const;
+
+    slib::vec3 DecodePosition(const PackedVertex& v) const
+    {
+        return {
+            positionOffset.x + v.position[0] * positionScale.x,
+            positionOffset.y + v.position[1] * positionScale.y,
+            positionOffset.z + v.position[2] * positionScale.z};
+    }
+
+    slib::vec2 DecodeTextureCoords(const PackedVertex& v) const
+    {
+        return {
+            textureOffset.x + v.textureCoords[0] * textureScale.x,
+            textureOffset.y + v.textureCoords[1] * textureScale.y};
+    }
+
+    static slib::vec3 DecodeNormal(const PackedVertex& v)
+    {
+        float x = v.normal[0] * (1.0f / 32767.0f);
+        float y = v.normal[1] * (1.0f / 32767.0f);
+        const float z = 1 - std::abs(x) - std::abs(y);
+        // The lower hemisphere was folded over the diagonals of the square; unfold it
+        const float t = std::max(-z, 0.0f);
+        x += x >= 0 ? -t : t;
+        y += y >= 0 ? -t : t;
+        const float length = std::sqrt(x * x + y * y + z * z);
+        return {x / length, y / length, z / length};
+    }
+};
+
+// Indexed triangles over packed vertices, with vertices shared between the triangles that use them
+struct MeshGeometry
+{
+    std::vector<PackedVertex> vertices;
+    std::vector<std::uint32_t> indices;  // Three per triangle
+    std::vector<std::int16_t> materials; // Per triangle, an index into Mesh::materials (-1 for none)
+
+    std::size_t TriangleCount() const
+    {
+        return materials.size();
+    }
+
+    // Welds identical corners of faces into shared vertices, then Optimizes
+    static MeshGeometry Pack(const std::vector<slib::tri>& faces, const VertexQuantization& quantization);
+    // Reorders the triangles so that those near each other in space are near each other in the list, and so
+    // that consecutive triangles share vertices, then the vertices into the order the triangles first use them.
+    // Triangles drawn in a batch then cover a compact patch of the screen, and assembling them reads the
+    // transformed vertices nearly sequentially.
+    void Optimize();
+};
+
+// A simplified version of a mesh
+struct MeshLod
+{
+    MeshGeometry geometry;
+    float error = 0; // Roughly how far (in model units) the simplified surface strays from the original
+};
+
+// Shared between renderables as std::shared_ptr<const Mesh> (see ResourceCache), which is what keeps it immutable.
+// The members themselves aren't const so that a freshly loaded mesh can be moved rather than copied.
 struct Mesh
 {
-    const std::vector<slib::tri> faces;
-    const std::map<std::string, slib::material> materials;
-    bool atlas = false; // Does this mesh use a texture atlas (requires 'tiles' of a consistent size)
-    int atlasTileSize = 32;
-    Mesh(const std::vector<slib::tri>& _faces,
-         const std::map<std::string, slib::material>&  _materials) :
-        faces(_faces),
-        materials(_materials)
+    std::vector<slib::material> materials; // Triangles refer to these by index
+    VertexQuantization quantization;        // Of geometry and every LOD
+    MeshGeometry geometry;
+    float boundingRadius = 0;  // Of a sphere around the model's origin that encloses every vertex
+    std::vector<MeshLod> lods; // Progressively coarser versions of geometry, coarsest last (see MeshSimplifier)
+
+    Mesh() = default;
+    // Packs faces, whose materials index into _materials
+    Mesh(const std::vector<slib::tri>& faces, std::vector<slib::material> _materials) :
+        materials(std::move(_materials)),
+        quantization(VertexQuantization::Fit(faces)),
+        geometry(MeshGeometry::Pack(faces, quantization))
     {
+        // From the packed positions, so the sphere encloses what is actually drawn
+        float radiusSquared = 0;
+        for (const auto& v : geometry.vertices)
+        {
+            const slib::vec3 p = quantization.DecodePosition(v);
+            radiusSquared = std::max(radiusSquared, p.x * p.x + p.y * p.y + p.z * p.z);
+        }
+        boundingRadius = std::sqrt(radiusSquared);
     }
 };
 }
@@ -0,0 +1,351 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "MeshCache.hpp"
+
+#include "MappedFile.hpp"
+#include "MeshSimplifier.hpp"
+#include "ObjParser.hpp"
+#include "ResourceCache.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+    // Bump the version whenever the layout below, or the way meshes are packed into it, changes
+    constexpr char magic[8] = {'S', 'A', 'G', 'E', 'M', 'S', 'H', '\0'};
+    constexpr std::uint32_t version = 5;
+
+    // File layout (native endianness; the cache is a local build artifact, not an interchange format):
+    //   magic, version
+    //   dependency count, then per dependency: path, content hash
+    //   vertex quantization, bounding radius
+    //   geometry: packed vertices, indices (3 per triangle), material index per triangle (-1 for none)
+    //   LOD count, then per LOD: error, geometry
+    //   material count, then per material: constants, map_Kd, map_Ks, map_Ns
+    //   (each texture is a present flag, then its path, size and pixels)
+    // Strings and arrays are prefixed by their length. Geometry is stored exactly as sage::Mesh holds it.
+
+    std::uint64_t fnv1a(const void* data, std::size_t size, std::uint64_t hash = 14695981039346656037ull)
+    {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::optional<std::uint64_t> hashFile(const std::string& path)
+    {
+        const sage::MappedFile file(path.c_str());
+        if (!file.IsOpen()) return std::nullopt;
+        return fnv1a(file.Data(), file.Size());
+    }
+
+    class Writer
+    {
+        std::ofstream out;
+
+      public:
+        explicit Writer(const std::string& path) : out(path, std::ios::binary)
+        {
+        }
+        bool Ok() const
+        {
+            return out.good();
+        }
+
+        template <typename T>
+        void Value(const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        void Array(const T* data, std::size_t count)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            Value(static_cast<std::uint64_t>(count));
+            out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+        }
+
+        void String(std::string_view s)
+        {
+            Array(s.data(), s.size());
+        }
+    };
+
+    // Bounds checked reads from the mapped cache. Any overrun marks the cache as unusable.
+    class Reader
+    {
+        const char* p;
+        const char* end;
+        bool ok = true;
+
+        bool take(std::size_t size)
+        {
+            ok = ok && static_cast<std::size_t>(end - p) >= size;
+            return ok;
+        }
+
+      public:
+        explicit Reader(std::string_view data) : p(data.data()), end(data.data() + data.size())
+        {
+        }
+        bool Ok() const
+        {
+            return ok;
+        }
+
+        template <typename T>
+        T Value()
+        {
+            T value{};
+            if (!take(sizeof(T))) return value;
+            std::memcpy(&value, p, sizeof(T));
+            p += sizeof(T);
+            return value;
+        }
+
+        // Returns a pointer into the mapping, or nullptr if the array would run past the end of the file
+        template <typename T>
+        const char* Array(std::uint64_t& count)
+        {
+            count = Value<std::uint64_t>();
+            if (!ok || count > static_cast<std::size_t>(end - p) / sizeof(T) || !take(count * sizeof(T)))
+            {
+                ok = false;
+                return nullptr;
+            }
+            const char* data = p;
+            p += count * sizeof(T);
+            return data;
+        }
+
+        std::string_view String()
+        {
+            std::uint64_t size = 0;
+            const char* data = Array<char>(size);
+            return data ? std::string_view{data, size} : std::string_view{};
+        }
+    };
+
+    std::string cachePath(const char* objPath)
+    {
+        return std::string(objPath) + ".smesh";
+    }
+
+    void writeTexture(Writer& out, const std::shared_ptr<const slib::texture>& texture)
+    {
+        out.Value(static_cast<std::uint8_t>(texture != nullptr));
+        if (!texture) return;
+        out.String(texture->path);
+        out.Value(static_cast<std::int32_t>(texture->w));
+        out.Value(static_cast<std::int32_t>(texture->h));
+        out.Value(static_cast<std::uint32_t>(texture->bpp));
+        out.Array(texture->data.data(), texture->data.size());
+    }
+
+    // Textures already loaded (by another mesh or scene) are shared rather than copied out of the cache again
+    std::shared_ptr<const slib::texture> readTexture(Reader& in)
+    {
+        if (!in.Value<std::uint8_t>()) return nullptr;
+        const std::string path(in.String());
+        const auto w = in.Value<std::int32_t>();
+        const auto h = in.Value<std::int32_t>();
+        const auto bpp = in.Value<std::uint32_t>();
+        std::uint64_t size = 0;
+        const char* data = in.Array<unsigned char>(size);
+        if (!in.Ok()) return nullptr;
+        return sage::ResourceCache::GetTexture(path, [&] {
+            return slib::texture{w, h, std::vector<unsigned char>(data, data + size), bpp, path};
+        });
+    }
+
+    void writeGeometry(Writer& out, const sage::MeshGeometry& geometry)
+    {
+        out.Array(geometry.vertices.data(), geometry.vertices.size());
+        out.Array(geometry.indices.data(), geometry.indices.size());
+        out.Array(geometry.materials.data(), geometry.materials.size());
+    }
+
+    // False if a dependency could not be read or anything failed to write
+    bool writeContents(Writer& out, const sage::Mesh& mesh, const std::vector<std::string>& dependencies)
+    {
+        out.Value(magic);
+        out.Value(version);
+
+        out.Value(static_cast<std::uint64_t>(dependencies.size()));
+        for (const auto& dependency : dependencies)
+        {
+            const auto hash = hashFile(dependency);
+            if (!hash) return false;
+            out.String(dependency);
+            out.Value(*hash);
+        }
+
+        out.Value(mesh.quantization);
+        out.Value(mesh.boundingRadius);
+        writeGeometry(out, mesh.geometry);
+        out.Value(static_cast<std::uint64_t>(mesh.lods.size()));
+        for (const auto& lod : mesh.lods)
+        {
+            out.Value(lod.error);
+            writeGeometry(out, lod.geometry);
+        }
+
+        out.Value(static_cast<std::uint64_t>(mesh.materials.size()));
+        for (const auto& material : mesh.materials)
+        {
+            out.Value(material.Ns);
+            out.Value(material.Ka);
+            out.Value(material.Kd);
+            out.Value(material.Ks);
+            out.Value(material.Ke);
+            out.Value(material.Ni);
+            out.Value(material.d);
+            out.Value(static_cast<std::int32_t>(material.illum));
+            writeTexture(out, material.map_Kd);
+            writeTexture(out, material.map_Ks);
+            writeTexture(out, material.map_Ns);
+        }
+        return out.Ok();
+    }
+
+    void writeCache(const char* objPath, const sage::Mesh& mesh, const std::vector<std::string>& dependencies)
+    {
+        // Written to a temporary file and renamed into place, so a reader never sees a partial cache
+        const std::string path = cachePath(objPath);
+        const std::string tempPath = path + ".tmp";
+        bool written;
+        {
+            Writer out(tempPath);
+            written = out.Ok() && writeContents(out, mesh, dependencies);
+        } // Closed before it's renamed or removed
+        if (written)
+        {
+            std::remove(path.c_str()); // rename() won't replace an existing file on Windows
+            written = std::rename(tempPath.c_str(), path.c_str()) == 0;
+        }
+        // Whatever went wrong, the temporary file isn't left behind
+        if (!written) std::remove(tempPath.c_str());
+    }
+
+    template <typename T>
+    bool readArray(Reader& in, std::vector<T>& values)
+    {
+        std::uint64_t count = 0;
+        const char* data = in.Array<T>(count);
+        if (!data) return false;
+        values.resize(count);
+        std::memcpy(values.data(), data, count * sizeof(T));
+        return true;
+    }
+
+    // Material indices can only be checked once the materials (which come last) are read; see validMaterials
+    bool readGeometry(Reader& in, sage::MeshGeometry& geometry)
+    {
+        if (!readArray(in, geometry.vertices) || !readArray(in, geometry.indices) ||
+            !readArray(in, geometry.materials) || geometry.indices.size() != geometry.materials.size() * 3)
+            return false;
+        const auto vertexCount = geometry.vertices.size();
+        return std::all_of(
+            geometry.indices.begin(), geometry.indices.end(), [vertexCount](auto i) { return i < vertexCount; });
+    }
+
+    bool validMaterials(const sage::MeshGeometry& geometry, std::size_t materialCount)
+    {
+        return std::all_of(geometry.materials.begin(), geometry.materials.end(), [materialCount](auto m) {
+            return m >= -1 && m < static_cast<std::int64_t>(materialCount);
+        });
+    }
+
+    // Returns false if there is no usable cache
+    bool readCache(const char* objPath, sage::Mesh& mesh)
+    {
+        const sage::MappedFile file(cachePath(objPath).c_str());
+        if (!file.IsOpen()) return false;
+        Reader in(file.View());
+
+        const auto fileMagic = in.Value<std::array<char, sizeof(magic)>>();
+        if (std::memcmp(fileMagic.data(), magic, sizeof(magic)) != 0 || in.Value<std::uint32_t>() != version)
+            return false;
+
+        // Stale if any source file has changed (or gone) since the cache was written
+        const auto dependencyCount = in.Value<std::uint64_t>();
+        for (std::uint64_t i = 0; in.Ok() && i < dependencyCount; ++i)
+        {
+            const std::string dependency(in.String());
+            const auto hash = in.Value<std::uint64_t>();
+            if (hashFile(dependency) != hash) return false;
+        }
+
+        mesh.quantization = in.Value<sage::VertexQuantization>();
+        mesh.boundingRadius = in.Value<float>();
+        if (!readGeometry(in, mesh.geometry)) return false;
+        const auto lodCount = in.Value<std::uint64_t>();
+        for (std::uint64_t i = 0; in.Ok() && i < lodCount; ++i)
+        {
+            sage::MeshLod lod;
+            lod.error = in.Value<float>();
+            if (!readGeometry(in, lod.geometry)) return false;
+            mesh.lods.push_back(std::move(lod));
+        }
+
+        const auto materialCount = in.Value<std::uint64_t>();
+        for (std::uint64_t i = 0; in.Ok() && i < materialCount; ++i)
+        {
+            slib::material material{};
+            material.Ns = in.Value<float>();
+            material.Ka = in.Value<std::array<float, 3>>();
+            material.Kd = in.Value<std::array<float, 3>>();
+            material.Ks = in.Value<std::array<float, 3>>();
+            material.Ke = in.Value<std::array<float, 3>>();
+            material.Ni = in.Value<float>();
+            material.d = in.Value<float>();
+            material.illum = in.Value<std::int32_t>();
+            material.map_Kd = readTexture(in);
+            material.map_Ks = readTexture(in);
+            material.map_Ns = readTexture(in);
+            mesh.materials.push_back(std::move(material));
+        }
+        if (!in.Ok() || !validMaterials(mesh.geometry, mesh.materials.size())) return false;
+        return std::all_of(mesh.lods.begin(), mesh.lods.end(), [&mesh](const sage::MeshLod& lod) {
+            return validMaterials(lod.geometry, mesh.materials.size());
+        });
+    }
+} // namespace
+
+namespace MeshCache
+{
+    sage::Mesh Load(const char* objPath)
+    {
+        {
+            sage::Mesh cached;
+            if (readCache(objPath, cached)) return cached;
+        }
+
+        std::vector<std::string> dependencies = {objPath};
+        auto model = ObjParser::ParseObj(objPath, &dependencies);
+        sage::Mesh mesh(model.faces, std::move(model.materials));
+        // Simplified from the full precision faces, then packed with the same quantization as the mesh
+        for (const auto& level : MeshSimplifier::BuildLods(model.faces))
+            mesh.lods.push_back({sage::MeshGeometry::Pack(level.faces, mesh.quantization), level.error});
+        writeCache(objPath, mesh, dependencies);
+        return mesh;
+    }
+} // namespace MeshCache
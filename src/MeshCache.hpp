@@ -0,0 +1,16 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "Mesh.hpp"
+
+namespace MeshCache
+{
+    // Loads an obj model through a binary cache kept next to it (<objPath>.smesh). The cache holds the
+    // vertex/index buffers, LODs (built with MeshSimplifier), materials and decoded textures, and records a
+    // content hash of the obj and every mtl and texture file it was built from. A missing or stale cache is
+    // rebuilt with ObjParser::ParseObj.
+    sage::Mesh Load(const char* objPath);
+}; // namespace MeshCache
@@ -0,0 +1,334 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <queue>
+#include <utility>
+
+namespace
+{
+    struct Vec3d
+    {
+        double x, y, z;
+        Vec3d operator+(const Vec3d& r) const
+        {
+            return {x + r.x, y + r.y, z + r.z};
+        }
+        Vec3d operator-(const Vec3d& r) const
+        {
+            return {x - r.x, y - r.y, z - r.z};
+        }
+        Vec3d operator*(double s) const
+        {
+            return {x * s, y * s, z * s};
+        }
+    };
+
+    double dot(const Vec3d& a, const Vec3d& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    Vec3d cross(const Vec3d& a, const Vec3d& b)
+    {
+        return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    }
+
+    double length(const Vec3d& v)
+    {
+        return std::sqrt(dot(v, v));
+    }
+
+    // Symmetric 4x4 matrix; error(p) is the sum of squared distances from p to the planes added to it
+    struct Quadric
+    {
+        double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+        static Quadric Plane(const Vec3d& n, double d, double weight)
+        {
+            return {
+                weight * n.x * n.x,
+                weight * n.x * n.y,
+                weight * n.x * n.z,
+                weight * n.x * d,
+                weight * n.y * n.y,
+                weight * n.y * n.z,
+                weight * n.y * d,
+                weight * n.z * n.z,
+                weight * n.z * d,
+                weight * d * d};
+        }
+
+        Quadric& operator+=(const Quadric& q)
+        {
+            a2 += q.a2, ab += q.ab, ac += q.ac, ad += q.ad, b2 += q.b2;
+            bc += q.bc, bd += q.bd, c2 += q.c2, cd += q.cd, d2 += q.d2;
+            return *this;
+        }
+
+        double Error(const Vec3d& p) const
+        {
+            const double e = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x +
+                             b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y + c2 * p.z * p.z + 2 * cd * p.z +
+                             d2;
+            return std::max(e, 0.0);
+        }
+    };
+
+    struct Triangle
+    {
+        int v[3];        // Welded position indices
+        int corner[3];   // Index of each corner's original vertex (texture coords and normal)
+        int material;
+        bool removed = false;
+    };
+
+    struct Collapse
+    {
+        double cost;
+        int keep, gone;
+        std::uint32_t keepVersion, goneVersion;
+        Vec3d position;
+        bool operator>(const Collapse& rhs) const
+        {
+            return cost > rhs.cost;
+        }
+    };
+
+    class Simplifier
+    {
+        std::vector<Vec3d> positions;
+        std::vector<Quadric> quadrics;
+        std::vector<std::vector<int>> vertexTriangles;
+        std::vector<std::uint32_t> versions; // Bumped whenever a vertex changes, to discard stale collapses
+        std::vector<bool> removedVertices;
+        std::vector<Triangle> triangles;
+        std::vector<slib::vertex> corners;
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> queue;
+        int liveTriangles = 0;
+        double maxCost = 0;
+
+        Vec3d normalOf(const Triangle& t, int replaced = -1, const Vec3d& with = {}) const
+        {
+            auto position = [&](int i) { return t.v[i] == replaced ? with : positions[t.v[i]]; };
+            return cross(position(1) - position(0), position(2) - position(0));
+        }
+
+        void pushCandidate(int a, int b)
+        {
+            Quadric q = quadrics[a];
+            q += quadrics[b];
+            const Vec3d midpoint = (positions[a] + positions[b]) * 0.5;
+            Collapse best{q.Error(positions[a]), a, b, versions[a], versions[b], positions[a]};
+            if (const double e = q.Error(positions[b]); e < best.cost)
+                best = {e, b, a, versions[b], versions[a], positions[b]};
+            if (const double e = q.Error(midpoint); e < best.cost)
+                best = {e, a, b, versions[a], versions[b], midpoint};
+            queue.push(best);
+        }
+
+        void pushNeighbours(int v)
+        {
+            for (const int t : vertexTriangles[v])
+            {
+                if (triangles[t].removed) continue;
+                for (const int other : triangles[t].v)
+                    if (other != v && other < v) pushCandidate(v, other);
+                    else if (other != v) pushCandidate(other, v);
+            }
+        }
+
+        // Rejects collapses that would fold a surviving triangle over
+        bool flips(const Collapse& c) const
+        {
+            for (const int v : {c.keep, c.gone})
+            {
+                for (const int ti : vertexTriangles[v])
+                {
+                    const Triangle& t = triangles[ti];
+                    if (t.removed) continue;
+                    const bool hasKeep = std::find(t.v, t.v + 3, c.keep) != t.v + 3;
+                    const bool hasGone = std::find(t.v, t.v + 3, c.gone) != t.v + 3;
+                    if (hasKeep && hasGone) continue; // Degenerates and is removed
+                    const Vec3d before = normalOf(t);
+                    const Vec3d after = normalOf(t, v, c.position);
+                    if (dot(before, after) < 0.2 * length(before) * length(after)) return true;
+                }
+            }
+            return false;
+        }
+
+        void collapse(const Collapse& c)
+        {
+            positions[c.keep] = c.position;
+            quadrics[c.keep] += quadrics[c.gone];
+            removedVertices[c.gone] = true;
+            ++versions[c.keep];
+            ++versions[c.gone];
+            for (const int ti : vertexTriangles[c.gone])
+            {
+                Triangle& t = triangles[ti];
+                if (t.removed) continue;
+                if (std::find(t.v, t.v + 3, c.keep) != t.v + 3)
+                {
+                    t.removed = true;
+                    --liveTriangles;
+                    continue;
+                }
+                std::replace(t.v, t.v + 3, c.gone, c.keep);
+                vertexTriangles[c.keep].push_back(ti);
+            }
+            vertexTriangles[c.gone].clear();
+            auto& kept = vertexTriangles[c.keep];
+            kept.erase(
+                std::remove_if(kept.begin(), kept.end(), [this](int t) { return triangles[t].removed; }),
+                kept.end());
+            maxCost = std::max(maxCost, c.cost);
+            pushNeighbours(c.keep);
+        }
+
+      public:
+        explicit Simplifier(const std::vector<slib::tri>& faces)
+        {
+            // Weld corners by position, so that texture and normal seams don't split the surface
+            std::map<std::tuple<float, float, float>, int> welded;
+            for (const auto& face : faces)
+            {
+                Triangle t{};
+                const slib::vertex* vertices[3] = {&face.v1, &face.v2, &face.v3};
+                for (int i = 0; i < 3; ++i)
+                {
+                    const auto& p = vertices[i]->position;
+                    const auto [it, inserted] =
+                        welded.try_emplace({p.x, p.y, p.z}, static_cast<int>(positions.size()));
+                    if (inserted) positions.push_back({p.x, p.y, p.z});
+                    t.v[i] = it->second;
+                    t.corner[i] = static_cast<int>(corners.size());
+                    corners.push_back(*vertices[i]);
+                }
+                t.material = face.material;
+                t.removed = t.v[0] == t.v[1] || t.v[1] == t.v[2] || t.v[0] == t.v[2];
+                liveTriangles += !t.removed;
+                triangles.push_back(t);
+            }
+
+            quadrics.resize(positions.size());
+            vertexTriangles.resize(positions.size());
+            versions.resize(positions.size());
+            removedVertices.resize(positions.size());
+            std::map<std::pair<int, int>, int> edgeUse;
+            for (int ti = 0; ti < static_cast<int>(triangles.size()); ++ti)
+            {
+                const Triangle& t = triangles[ti];
+                if (t.removed) continue;
+                const Vec3d n = normalOf(t);
+                const double area = length(n);
+                if (area == 0) continue;
+                const Vec3d unit = n * (1 / area);
+                const Quadric q = Quadric::Plane(unit, -dot(unit, positions[t.v[0]]), 1);
+                for (int i = 0; i < 3; ++i)
+                {
+                    quadrics[t.v[i]] += q;
+                    vertexTriangles[t.v[i]].push_back(ti);
+                    ++edgeUse[std::minmax(t.v[i], t.v[(i + 1) % 3])];
+                }
+            }
+
+            // Open edges get a plane perpendicular to their triangle, so the outline of the mesh is kept
+            for (const auto& t : triangles)
+            {
+                if (t.removed) continue;
+                const Vec3d n = normalOf(t);
+                if (length(n) == 0) continue;
+                for (int i = 0; i < 3; ++i)
+                {
+                    const int a = t.v[i], b = t.v[(i + 1) % 3];
+                    if (edgeUse[std::minmax(a, b)] != 1) continue;
+                    const Vec3d edge = positions[b] - positions[a];
+                    Vec3d side = cross(edge, n);
+                    const double sideLength = length(side);
+                    if (sideLength == 0) continue;
+                    side = side * (1 / sideLength);
+                    const Quadric q = Quadric::Plane(side, -dot(side, positions[a]), 10);
+                    quadrics[a] += q;
+                    quadrics[b] += q;
+                }
+            }
+
+            for (const auto& [edge, uses] : edgeUse)
+                pushCandidate(edge.first, edge.second);
+        }
+
+        int LiveTriangles() const
+        {
+            return liveTriangles;
+        }
+
+        // Collapses edges until at most target triangles remain. False if it ran out of valid collapses first.
+        bool SimplifyTo(int target)
+        {
+            while (liveTriangles > target)
+            {
+                if (queue.empty()) return false;
+                const Collapse c = queue.top();
+                queue.pop();
+                if (removedVertices[c.keep] || removedVertices[c.gone] || versions[c.keep] != c.keepVersion ||
+                    versions[c.gone] != c.goneVersion)
+                    continue;
+                if (flips(c)) continue;
+                collapse(c);
+            }
+            return true;
+        }
+
+        MeshSimplifier::Level Snapshot() const
+        {
+            MeshSimplifier::Level lod;
+            lod.error = static_cast<float>(std::sqrt(maxCost));
+            lod.faces.reserve(liveTriangles);
+            for (const auto& t : triangles)
+            {
+                if (t.removed) continue;
+                slib::tri face{};
+                slib::vertex* out[3] = {&face.v1, &face.v2, &face.v3};
+                for (int i = 0; i < 3; ++i)
+                {
+                    *out[i] = corners[t.corner[i]];
+                    const Vec3d& p = positions[t.v[i]];
+                    out[i]->position = {static_cast<float>(p.x), static_cast<float>(p.y), static_cast<float>(p.z)};
+                }
+                face.material = t.material;
+                lod.faces.push_back(std::move(face));
+            }
+            return lod;
+        }
+    };
+} // namespace
+
+namespace MeshSimplifier
+{
+    std::vector<Level> BuildLods(const std::vector<slib::tri>& faces, int minTriangles)
+    {
+        std::vector<Level> lods;
+        Simplifier simplifier(faces);
+        int previous = simplifier.LiveTriangles();
+        while (previous / 2 >= minTriangles)
+        {
+            const bool reached = simplifier.SimplifyTo(previous / 2);
+            // Not worth a level of its own unless it removed a good share of the triangles
+            if (simplifier.LiveTriangles() > previous * 3 / 4) break;
+            lods.push_back(simplifier.Snapshot());
+            previous = simplifier.LiveTriangles();
+            if (!reached) break;
+        }
+        return lods;
+    }
+} // namespace MeshSimplifier
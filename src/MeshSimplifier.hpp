@@ -0,0 +1,23 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "slib.hpp"
+
+#include <vector>
+
+namespace MeshSimplifier
+{
+    struct Level
+    {
+        std::vector<slib::tri> faces;
+        float error = 0; // Roughly how far (in model units) the simplified surface strays from the original
+    };
+
+    // Builds progressively coarser copies of faces (roughly halving the triangle count each level) by quadric
+    // error metric edge collapse (Garland & Heckbert). Stops once a level would have fewer than minTriangles
+    // or the mesh can't be simplified further.
+    std::vector<Level> BuildLods(const std::vector<slib::tri>& faces, int minTriangles = 64);
+}; // namespace MeshSimplifier
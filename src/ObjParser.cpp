@@ -5,17 +5,23 @@
 #include "ObjParser.hpp"
 
 #include "constants.hpp"
+#include "MappedFile.hpp"
+#include "ResourceCache.hpp"
 #include "slib.hpp"
 
 #include "lodepng.h"
 
 #include <algorithm>
 #include <cassert>
-#include <fstream>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
-#include <regex>
-#include <sstream>
+#include <map>
+#include <omp.h>
 #include <string>
+#include <string_view>
 
 slib::texture DecodePng(const char* filename)
 {
@@ -39,47 +45,109 @@ slib::texture DecodePng(const char* filename)
 
     // the pixels are now in the vector "image", 4 bytes per pixel, ordered RGBARGBA..., use it as texture, draw
     // it, ...
-    return {static_cast<int>(width), static_cast<int>(height), image, 4};
+    return {static_cast<int>(width), static_cast<int>(height), image, 4, filename};
 }
 
-std::string trim(const std::string& input)
+// Forward only scanner over a memory mapped file. Tokens are views into the mapping, so nothing is copied or
+// allocated per line.
+struct Scanner
 {
-    std::string output;
-    // Remove excessive whitespace
-    std::unique_copy(
-        input.begin(), input.end(), std::back_insert_iterator<std::string>(output), [](char a, char b) {
-            return std::isspace(a) && std::isspace(b);
-        });
-    // Removes characters with ASCII value 0-31 (control characters)
-    output.erase(std::remove_if(output.begin(), output.end(), [](char c) { return (c <= 31); }), output.end());
-    return output;
+    const char* p;
+    const char* end;
+
+    bool done() const
+    {
+        return p >= end;
+    }
+
+    // Skips spaces and tabs (and the '\r' of "\r\n" endings) but never the end of the line
+    void skipSpaces()
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+    }
+
+    void nextLine()
+    {
+        const auto* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        p = newline ? newline + 1 : end;
+    }
+
+    bool atLineEnd()
+    {
+        skipSpaces();
+        return p >= end || *p == '\n';
+    }
+
+    std::string_view word()
+    {
+        skipSpaces();
+        const char* start = p;
+        while (p < end && !std::isspace(static_cast<unsigned char>(*p))) ++p;
+        return {start, static_cast<std::size_t>(p - start)};
+    }
+
+    // The remainder of the line without surrounding whitespace (file names may contain spaces)
+    std::string_view rest()
+    {
+        skipSpaces();
+        const char* start = p;
+        while (p < end && *p != '\n') ++p;
+        const char* last = p;
+        while (last > start && std::isspace(static_cast<unsigned char>(last[-1]))) --last;
+        return {start, static_cast<std::size_t>(last - start)};
+    }
+
+    template <typename T>
+    bool number(T& out)
+    {
+        skipSpaces();
+        if (p < end && *p == '+') ++p; // from_chars doesn't accept a leading '+'
+        const auto [ptr, ec] = std::from_chars(p, end, out);
+        if (ec != std::errc()) return false;
+        p = ptr;
+        return true;
+    }
+
+    template <std::size_t N>
+    bool numbers(std::array<float, N>& out)
+    {
+        for (auto& f : out)
+            if (!number(f)) return false;
+        return true;
+    }
+};
+
+[[noreturn]] void parseError(const char* path, std::string_view what)
+{
+    std::cout << "Error. Failed to parse " << path << ": " << what << std::endl;
+    exit(1);
 }
 
-struct tri_obj
+// One corner of a face: indices into the v/vt/vn arrays, -1 where the attribute is absent.
+// Negative (relative) OBJ indices are resolved against the chunk they were read in; the flagged ones are
+// offset by the chunk's first element once the chunks are merged.
+struct obj_index
 {
-    const int v1, v2, v3;
-    const int vt1, vt2, vt3;
-    const int vn1, vn2, vn3;
-    const std::string material;
+    enum : std::uint8_t
+    {
+        RELATIVE_V = 1,
+        RELATIVE_VT = 2,
+        RELATIVE_VN = 4
+    };
+    int v, vt, vn;
+    std::uint8_t relative;
 };
 
-std::array<float, 3> parseVectorLine(const std::string& input)
+struct tri_obj
 {
-    std::stringstream ss(input);
-    std::array<float, 3> arr{};
-    std::string token;
-    int i = 0;
-    while (std::getline(ss, token, ' '))
-    {
-        arr.at(i++) = std::stof(token);
-    }
-    return arr;
-}
+    obj_index corners[3];
+    int material; // Index into the chunk's material names, -1 for the material the previous chunk ended on
+};
 
-std::map<std::string, slib::material> parseMtlFile(const char* path)
+std::map<std::string, slib::material> parseMtlFile(const char* path, std::vector<std::string>* dependencies)
 {
-    std::ifstream mtl(path);
-    if (!mtl.is_open())
+    const sage::MappedFile mtl(path);
+    if (!mtl.IsOpen())
     {
         std::cout << "Failed to open materials file" << std::endl;
         exit(1);
@@ -87,290 +155,290 @@ std::map<std::string, slib::material> parseMtlFile(const char* path)
 
     std::map<std::string, slib::material> toReturn;
     std::string materialKey;
-    std::string line;
     slib::material material{};
 
-    while (getline(mtl, line))
+    auto loadTexture = [dependencies](std::string_view file) {
+        const std::string texturePath = RES_PATH + std::string(file);
+        if (dependencies) dependencies->push_back(texturePath);
+        return sage::ResourceCache::GetTexture(
+            texturePath, [&texturePath] { return DecodePng(texturePath.c_str()); });
+    };
+
+    for (Scanner in{mtl.Data(), mtl.Data() + mtl.Size()}; !in.done(); in.nextLine())
     {
-        line = trim(line);
-        if (line[0] == '#') continue;
-        if (line.find("newmtl") != std::string::npos)
+        const std::string_view key = in.word();
+        bool ok = true;
+        if (key == "newmtl")
         {
-            if (!materialKey.empty()) // Store the previous material
+            if (!materialKey.empty()) // Store the previous material, replacing any earlier one of the same name
             {
-                toReturn.insert({materialKey, material});
+                toReturn.insert_or_assign(materialKey, std::move(material));
                 material = {};
             }
-            materialKey = line.substr(line.find("newmtl") + std::string("newmtl ").length());
-        }
-        else if (line.find("map_Kd") != std::string::npos)
-        {
-            std::string mtlPath = line.substr(line.find("map_Kd") + std::string("map_Kd ").length());
-            material.map_Kd = DecodePng(std::string(RES_PATH + mtlPath).c_str());
-            ;
-        }
-        else if (line.find("map_Ks") != std::string::npos)
-        {
-            std::string mtlPath = line.substr(line.find("map_Ks") + std::string("map_Ks ").length());
-            material.map_Ks = DecodePng(std::string(RES_PATH + mtlPath).c_str());
-            ;
-        }
-        else if (line.find("map_Ns") != std::string::npos)
-        {
-            std::string mtlPath = line.substr(line.find("map_Ns") + std::string("map_Ns ").length());
-            material.map_Ns = DecodePng(std::string(RES_PATH + mtlPath).c_str());
-            ;
-        }
-        else if (line.find("map_Disp") != std::string::npos)
-        {
+            materialKey = in.rest();
         }
-        else if (line.find("map_Ka") != std::string::npos)
-        {
-        }
-        else if (line.find("map_d") != std::string::npos)
-        {
-        }
-        else if (line.find("Ka") != std::string::npos)
-        {
-            std::string input = line.substr(line.find("Ka ") + std::string("Ka ").length());
-            std::array<float, 3> arr = parseVectorLine(input);
-            material.Ka[0] = arr.at(0);
-            material.Ka[1] = arr.at(1);
-            material.Ka[2] = arr.at(2);
-        }
-        else if (line.find("Kd") != std::string::npos)
+        else if (key == "map_Kd")
+            material.map_Kd = loadTexture(in.rest());
+        else if (key == "map_Ks")
+            material.map_Ks = loadTexture(in.rest());
+        else if (key == "map_Ns")
+            material.map_Ns = loadTexture(in.rest());
+        else if (key == "Ka")
+            ok = in.numbers(material.Ka);
+        else if (key == "Kd")
+            ok = in.numbers(material.Kd);
+        else if (key == "Ks")
+            ok = in.numbers(material.Ks);
+        else if (key == "Ke")
+            ok = in.numbers(material.Ke);
+        else if (key == "Ni")
+            ok = in.number(material.Ni);
+        else if (key == "Ns")
+            ok = in.number(material.Ns);
+        else if (key == "d")
+            ok = in.number(material.d);
+        else if (key == "illum")
+            ok = in.number(material.illum);
+        // Comments and unsupported statements (map_Disp, map_Ka, map_d etc.) are ignored
+
+        if (!ok) parseError(path, key);
+    }
+
+    toReturn.insert_or_assign(materialKey, std::move(material));
+    return toReturn;
+}
+
+// Reads one "v", "v/vt", "v//vn" or "v/vt/vn" corner. OBJ indices are 1-based, negative indices count back
+// from the most recently read element.
+bool parseCorner(Scanner& in, obj_index& out, int vertexCount, int textureCount, int normalCount)
+{
+    out = {0, -1, -1, 0};
+    auto read = [&in, &out](int& index, int count, std::uint8_t relativeFlag) {
+        int value = 0;
+        const auto [ptr, ec] = std::from_chars(in.p, in.end, value);
+        if (ec != std::errc() || value == 0) return false;
+        in.p = ptr;
+        index = value > 0 ? value - 1 : count + value;
+        if (value < 0) out.relative |= relativeFlag;
+        return true;
+    };
+    in.skipSpaces();
+    if (!read(out.v, vertexCount, obj_index::RELATIVE_V)) return false;
+    if (in.p < in.end && *in.p == '/')
+    {
+        ++in.p;
+        if (in.p < in.end && *in.p != '/' && !read(out.vt, textureCount, obj_index::RELATIVE_VT)) return false;
+        if (in.p < in.end && *in.p == '/')
         {
-            std::string input = line.substr(line.find("Kd ") + std::string("Kd ").length());
-            std::array<float, 3> arr = parseVectorLine(input);
-            material.Kd[0] = arr.at(0);
-            material.Kd[1] = arr.at(1);
-            material.Kd[2] = arr.at(2);
+            ++in.p;
+            if (!read(out.vn, normalCount, obj_index::RELATIVE_VN)) return false;
         }
-        else if (line.find("Ks") != std::string::npos)
+    }
+    return true;
+}
+
+// Everything read from one chunk of the file. Chunks are parsed independently, so indices and material state
+// that depend on earlier chunks are fixed up when they are merged.
+struct ObjChunk
+{
+    std::vector<slib::vec3> vertices;
+    std::vector<slib::vec3> normals;
+    std::vector<slib::vec2> textureCoords;
+    std::vector<tri_obj> faces;
+    std::vector<std::string_view> materialNames; // usemtl names, in order of first use within the chunk
+    int endMaterial = -1;                        // Material in use at the end of the chunk (as for faces)
+    std::vector<std::string_view> materialLibraries;
+    std::string_view error; // The statement that failed to parse, if any
+};
+
+void parseChunk(const char* begin, const char* end, ObjChunk& chunk)
+{
+    std::vector<obj_index> polygon; // Corners of the face being read, reused between lines
+    for (Scanner in{begin, end}; !in.done(); in.nextLine())
+    {
+        const std::string_view key = in.word();
+        if (key == "v")
         {
-            std::string input = line.substr(line.find("Ks ") + std::string("Ks ").length());
-            std::array<float, 3> arr = parseVectorLine(input);
-            material.Ks[0] = arr.at(0);
-            material.Ks[1] = arr.at(1);
-            material.Ks[2] = arr.at(2);
+            slib::vec3& v = chunk.vertices.emplace_back();
+            if (!in.number(v.x) || !in.number(v.y) || !in.number(v.z)) chunk.error = "vertex";
         }
-        else if (line.find("Ke") != std::string::npos)
+        else if (key == "vt")
         {
-            std::string input = line.substr(line.find("Ke ") + std::string("Ke ").length());
-            std::array<float, 3> arr = parseVectorLine(input);
-            material.Ke[0] = arr.at(0);
-            material.Ke[1] = arr.at(1);
-            material.Ke[2] = arr.at(2);
+            slib::vec2& vt = chunk.textureCoords.emplace_back();
+            if (!in.number(vt.x) || !in.number(vt.y)) chunk.error = "texture coordinate";
         }
-        else if (line.find("Ni") != std::string::npos)
+        else if (key == "vn")
         {
-            material.Ni = std::stof(line.substr(line.find("Ni ") + std::string("Ni ").length()));
+            slib::vec3& vn = chunk.normals.emplace_back();
+            if (!in.number(vn.x) || !in.number(vn.y) || !in.number(vn.z)) chunk.error = "normal";
         }
-        else if (line.find("Ns") != std::string::npos)
+        else if (key == "f")
         {
-            material.Ns = std::stof(line.substr(line.find("Ns ") + std::string("Ns ").length()));
+            const auto vertexCount = static_cast<int>(chunk.vertices.size());
+            const auto textureCount = static_cast<int>(chunk.textureCoords.size());
+            const auto normalCount = static_cast<int>(chunk.normals.size());
+            polygon.clear();
+            while (!in.atLineEnd() && chunk.error.empty())
+            {
+                if (!parseCorner(in, polygon.emplace_back(), vertexCount, textureCount, normalCount))
+                    chunk.error = "face";
+            }
+            if (polygon.size() < 3) chunk.error = "face";
+            // Polygons are split into a triangle fan
+            for (std::size_t i = 2; i < polygon.size(); ++i)
+            {
+                chunk.faces.push_back({{polygon[0], polygon[i - 1], polygon[i]}, chunk.endMaterial});
+            }
         }
-        else if (line.find('d') != std::string::npos)
+        else if (key == "usemtl")
         {
-            material.d = std::stof(line.substr(line.find("d ") + std::string("d ").length()));
+            const std::string_view name = in.rest();
+            const auto it = std::find(chunk.materialNames.begin(), chunk.materialNames.end(), name);
+            chunk.endMaterial = static_cast<int>(it - chunk.materialNames.begin());
+            if (it == chunk.materialNames.end()) chunk.materialNames.push_back(name);
         }
-        else if (line.find("illum") != std::string::npos)
+        else if (key == "mtllib")
         {
-            material.illum = std::stoi(line.substr(line.find("illum ") + std::string("illum ").length()));
+            chunk.materialLibraries.push_back(in.rest());
         }
+        if (!chunk.error.empty()) return;
     }
-
-    toReturn.insert({materialKey, material});
-
-    mtl.close();
-    return toReturn;
 }
 
-slib::vec3 getVector(const std::string& line)
-{
-    std::array<float, 3> arr = parseVectorLine(line);
-    return {arr.at(0), arr.at(1), arr.at(2)};
-}
-
-slib::vec2 getTextureVector(const std::string& line)
-{
-    std::array<float, 3> arr = parseVectorLine(line);
-    return {arr.at(0), arr.at(1)};
-}
-
-tri_obj getFace(const std::string& line, std::string material)
+namespace ObjParser
 {
-    enum VertexFormat
+    ObjModel ParseObj(const char* objPath, std::vector<std::string>* dependencies)
     {
-        V,
-        V_VN,
-        V_VT_VN,
-        INVALID
-    };
-
-    std::string output = line;
-    output.erase(0, 2);
-    std::stringstream ss(output);
-    std::vector<int> vertices;
-    std::vector<int> textureCoords;
-    std::vector<int> normals;
-    std::string token;
-
-    std::regex v_pattern(R"(^\d+ \d+ \d+\s*$)");
-    std::regex v_vn_pattern(R"(^\d+//\d+ \d+//\d+ \d+//\d+\s*$)");
-    std::regex v_vt_vn_pattern(R"(^\d+/\d+/\d+ \d+/\d+/\d+ \d+/\d+/\d+\s*$)");
-
-    VertexFormat format = INVALID;
-    if (std::regex_match(output, v_pattern))
-        format = V;
-    else if (std::regex_match(output, v_vn_pattern))
-        format = V_VN;
-    else if (std::regex_match(output, v_vt_vn_pattern))
-        format = V_VT_VN;
-
-    if (format == INVALID)
-    {
-        std::cout << "Error. Failed to parse faces in obj file." << '\n';
-        std::cout << "Face string: " << output << std::endl;
-        exit(1);
-    }
-
-    while (std::getline(ss, token, ' '))
-    {
-        switch (format)
+        const sage::MappedFile obj(objPath);
+        if (!obj.IsOpen())
         {
-        case V:
-            vertices.push_back(std::stoi(token) - 1);
-            break;
-        case V_VN:
-            vertices.push_back(std::stoi(token.substr(0, token.find("//"))) - 1);
-            normals.push_back(std::stoi(token.substr(token.find("//") + 2)) - 1);
-            break;
-        case V_VT_VN:
-            vertices.push_back(std::stoi(token.substr(0, token.find('/'))) - 1);
-            token.erase(0, token.find('/') + 1);
-            textureCoords.push_back(std::stoi(token.substr(0, token.find('/'))) - 1);
-            token.erase(0, token.find('/') + 1);
-            normals.push_back(std::stoi(token) - 1);
+            std::cout << "Failed to open file" << std::endl;
+            exit(1);
         }
-    }
 
-    switch (format)
-    {
-    case V:
-        return {vertices.at(0), vertices.at(1), vertices.at(2), -1, -1, -1, -1, -1, -1, ""};
-    case V_VN:
-        return {
-            vertices.at(0),
-            vertices.at(1),
-            vertices.at(2),
-            -1,
-            -1,
-            -1,
-            normals.at(0),
-            normals.at(1),
-            normals.at(2),
-            ""};
-    case V_VT_VN:
-        return {
-            vertices.at(0),
-            vertices.at(1),
-            vertices.at(2),
-            textureCoords.at(0),
-            textureCoords.at(1),
-            textureCoords.at(2),
-            normals.at(0),
-            normals.at(1),
-            normals.at(2),
-            std::move(material)};
-    }
-}
+        // Split the file at line boundaries into one chunk per thread. Small files aren't worth splitting.
+        constexpr std::size_t minChunkSize = 64 * 1024;
+        const char* data = obj.Data();
+        const std::size_t size = obj.Size();
+        const auto chunkCount = static_cast<std::size_t>(
+            std::clamp<std::size_t>(size / minChunkSize, 1, static_cast<std::size_t>(omp_get_max_threads())));
+        std::vector<const char*> bounds(chunkCount + 1, data + size);
+        bounds[0] = data;
+        for (std::size_t i = 1; i < chunkCount; ++i)
+        {
+            const char* split = std::max(data + size * i / chunkCount, bounds[i - 1]);
+            const auto* newline = static_cast<const char*>(std::memchr(split, '\n', data + size - split));
+            bounds[i] = newline ? newline + 1 : data + size;
+        }
 
-namespace ObjParser
-{
-    sage::Mesh ParseObj(const char* objPath)
-    {
-        std::ifstream obj(objPath);
-        if (!obj.is_open())
+        std::vector<ObjChunk> chunks(chunkCount);
+#pragma omp parallel for default(none) shared(chunks, bounds, chunkCount) schedule(dynamic)
+        for (std::size_t i = 0; i < chunkCount; ++i)
         {
-            std::cout << "Failed to open file" << std::endl;
-            exit(1);
+            parseChunk(bounds[i], bounds[i + 1], chunks[i]);
         }
 
+        // Merge: where each chunk's elements start in the combined arrays, and its materials in global terms
+        struct ChunkOffsets
+        {
+            int v, vt, vn;
+            std::size_t face;
+            std::vector<int> materials; // Chunk material index -> global material name index
+            int startMaterial;          // Global index of the material in use when the chunk begins
+        };
+        std::vector<ChunkOffsets> offsets(chunkCount);
+        std::vector<std::string> materialNames; // Faces refer to these by index
         std::map<std::string, slib::material> materials;
-        std::string currentTextureName;
         std::vector<slib::vec3> vertices;
         std::vector<slib::vec3> normals; // The normals as listed in the obj file
         std::vector<slib::vec2> textureCoords;
-        std::vector<tri_obj> rawfaces; // faces in obj data (indices to arrays: v/vt/vn)
-        std::vector<slib::tri> faces;  // faces with data written directly (no separate arrays needed)
-        std::string line;
-
-        while (getline(obj, line))
+        std::size_t faceCount = 0;
+        int currentMaterial = -1;
+        for (std::size_t i = 0; i < chunkCount; ++i)
         {
-            line = trim(line);
-            if (line.size() < 2) continue;
-            if (line[0] == '#') continue;
-
-            if (line.substr(0, 2) == "v ")
+            ObjChunk& chunk = chunks[i];
+            if (!chunk.error.empty()) parseError(objPath, chunk.error);
+
+            ChunkOffsets& offset = offsets[i];
+            offset.v = static_cast<int>(vertices.size());
+            offset.vt = static_cast<int>(textureCoords.size());
+            offset.vn = static_cast<int>(normals.size());
+            offset.face = faceCount;
+            offset.startMaterial = currentMaterial;
+            for (const auto name : chunk.materialNames)
             {
-                vertices.push_back(getVector(line.erase(0, 2)));
+                const auto it = std::find(materialNames.begin(), materialNames.end(), name);
+                offset.materials.push_back(static_cast<int>(it - materialNames.begin()));
+                if (it == materialNames.end()) materialNames.emplace_back(name);
             }
-            else if (line.substr(0, 2) == "f ")
+            if (chunk.endMaterial >= 0) currentMaterial = offset.materials[chunk.endMaterial];
+            for (const auto library : chunk.materialLibraries)
             {
-                rawfaces.push_back(getFace(line, currentTextureName));
-            }
-            else if (line.substr(0, 2) == "vt")
-            {
-                textureCoords.push_back(getTextureVector(line.erase(0, 3)));
-            }
-            else if (line.substr(0, 2) == "vn")
-            {
-                normals.push_back(getVector(line.erase(0, 3)));
-            }
-            else if (line.find("usemtl") != std::string::npos)
-            {
-                currentTextureName = line.substr(line.find("usemtl") + std::string("usemtl ").length());
-            }
-            else if (line.find("mtllib") != std::string::npos)
-            {
-                auto path =
-                    std::string(RES_PATH + line.substr(line.find("mtllib") + std::string("mtllib ").length()));
-                materials = parseMtlFile(path.c_str());
+                const std::string libraryPath = RES_PATH + std::string(library);
+                if (dependencies) dependencies->push_back(libraryPath);
+                // A material defined again (in a later library) replaces the earlier definition
+                for (auto& [name, material] : parseMtlFile(libraryPath.c_str(), dependencies))
+                    materials.insert_or_assign(name, std::move(material));
             }
+
+            vertices.insert(vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+            textureCoords.insert(textureCoords.end(), chunk.textureCoords.begin(), chunk.textureCoords.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+            faceCount += chunk.faces.size();
         }
 
         assert(!vertices.empty());
-        assert(!normals.empty());
-        assert(!textureCoords.empty());
-        assert(!rawfaces.empty());
-
-        faces.reserve(rawfaces.size());
-        // #pragma omp parallel for default(none) shared(vertices, normals, textureCoords, rawfaces, faces)
-        for (const tri_obj& tri : rawfaces)
+        assert(faceCount > 0);
+
+        // faces with data written directly (no separate arrays needed)
+        std::vector<slib::tri> faces(faceCount);
+        const auto vertexCount = static_cast<int>(vertices.size());
+        const auto textureCount = static_cast<int>(textureCoords.size());
+        const auto normalCount = static_cast<int>(normals.size());
+        bool outOfRange = false;
+#pragma omp parallel for default(none) schedule(dynamic) reduction(|| : outOfRange)                               \
+    shared(chunks, offsets, chunkCount, faces, vertices, normals, textureCoords, vertexCount, textureCount,      \
+               normalCount)
+        for (std::size_t i = 0; i < chunkCount; ++i)
         {
-            slib::tri tri_n{};
-            slib::vertex vx1{};
-            slib::vertex vx2{};
-            slib::vertex vx3{};
-            vx1.position = vertices[tri.v1];
-            vx2.position = vertices[tri.v2];
-            vx3.position = vertices[tri.v3];
-            vx1.normal = normals[tri.vn1];
-            vx2.normal = normals[tri.vn2];
-            vx3.normal = normals[tri.vn3];
-            vx1.textureCoords = textureCoords[tri.vt1];
-            vx2.textureCoords = textureCoords[tri.vt2];
-            vx3.textureCoords = textureCoords[tri.vt3];
-            tri_n.material = tri.material;
-            tri_n.v1 = vx1;
-            tri_n.v2 = vx2;
-            tri_n.v3 = vx3;
-            faces.push_back(tri_n);
+            const ChunkOffsets& offset = offsets[i];
+            for (std::size_t f = 0; f < chunks[i].faces.size(); ++f)
+            {
+                const tri_obj& raw = chunks[i].faces[f];
+                slib::tri& tri = faces[offset.face + f];
+                slib::vertex* out[3] = {&tri.v1, &tri.v2, &tri.v3};
+                for (int c = 0; c < 3; ++c)
+                {
+                    obj_index corner = raw.corners[c];
+                    if (corner.relative & obj_index::RELATIVE_V) corner.v += offset.v;
+                    if (corner.relative & obj_index::RELATIVE_VT) corner.vt += offset.vt;
+                    if (corner.relative & obj_index::RELATIVE_VN) corner.vn += offset.vn;
+                    // -1 means absent only if no index was given; a relative one that lands there is out of range
+                    const int vtMin = corner.relative & obj_index::RELATIVE_VT ? 0 : -1;
+                    const int vnMin = corner.relative & obj_index::RELATIVE_VN ? 0 : -1;
+                    if (corner.v < 0 || corner.v >= vertexCount || corner.vt < vtMin ||
+                        corner.vt >= textureCount || corner.vn < vnMin || corner.vn >= normalCount)
+                    {
+                        outOfRange = true;
+                        continue;
+                    }
+                    out[c]->position = vertices[corner.v];
+                    if (corner.vt >= 0) out[c]->textureCoords = textureCoords[corner.vt];
+                    if (corner.vn >= 0) out[c]->normal = normals[corner.vn];
+                }
+                tri.material = raw.material >= 0 ? offset.materials[raw.material] : offset.startMaterial;
+            }
         }
-        // #pragma omp barrier
+        if (outOfRange) parseError(objPath, "face index out of range");
 
-        obj.close();
-        return {faces, materials};
+        // Faces index materials in the order their names were first used. Names no library defines get defaults.
+        std::vector<slib::material> usedMaterials;
+        usedMaterials.reserve(materialNames.size());
+        for (const auto& name : materialNames)
+        {
+            const auto it = materials.find(name);
+            usedMaterials.push_back(it != materials.end() ? std::move(it->second) : slib::material{});
+        }
+        return {std::move(faces), std::move(usedMaterials)};
     }
-} // namespace ObjParser
\ No newline at end of file
+} // namespace ObjParser
@@ -5,11 +5,20 @@
 #pragma once
 #include <vector>
 #include <array>
+#include <string>
 #include "slib.hpp"
 #include "Mesh.hpp"
 
 
 namespace ObjParser
 {
-    sage::Mesh ParseObj(const char* objPath);
+    // The faces of an obj file, each referring to its material by index into materials
+    struct ObjModel
+    {
+        std::vector<slib::tri> faces;
+        std::vector<slib::material> materials;
+    };
+
+    // If dependencies is given, the paths of the mtl and texture files that were read are appended to it.
+    ObjModel ParseObj(const char* objPath, std::vector<std::string>* dependencies = nullptr);
 };
\ No newline at end of file
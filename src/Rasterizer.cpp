@@ -6,24 +6,22 @@
 #include "constants.hpp"
 #include "slib.hpp"
 #include <algorithm>
+#include <bit>
 #include <cmath>
 #include <iostream>
 
 namespace sage
 {
-
-    inline void bufferPixels(SDL_Surface* surface, int x, int y, unsigned char r, unsigned char g, unsigned char b)
+    // As the framebuffer stores it: 32-bit ARGB (so B, G, R, A in memory)
+    inline std::uint32_t packColor(int r, int g, int b)
     {
-        auto* pixels = static_cast<unsigned char*>(surface->pixels);
-        pixels[4 * (y * surface->w + x) + 0] = b;
-        pixels[4 * (y * surface->w + x) + 1] = g;
-        pixels[4 * (y * surface->w + x) + 2] = r;
-        pixels[4 * (y * surface->w + x) + 3] = 255;
+        return 0xff000000u | static_cast<std::uint32_t>(r) << 16 | static_cast<std::uint32_t>(g) << 8 |
+               static_cast<std::uint32_t>(b);
     }
 
     // GL_NEAREST
     inline void texNearestNeighbour(
-        const slib::texture& texture, float lum, float uvx, float uvy, int& r, int& g, int& b)
+        const slib::texture& texture, const slib::vec3& lum, float uvx, float uvy, int& r, int& g, int& b)
     {
         // Convert to texture space
         auto tx = static_cast<int>(uvx * texture.w);
@@ -32,24 +30,17 @@ namespace sage
         // Grab the corresponding pixel color on the texture
         int index = (ty * texture.w + tx) * texture.bpp;
 
-        if (lum > 1)
-        {
-            r = std::max(0, std::min(static_cast<int>(texture.data[index] * lum), 255));
-            g = std::max(0, std::min(static_cast<int>(texture.data[index + 1] * lum), 255));
-            b = std::max(0, std::min(static_cast<int>(texture.data[index + 2] * lum), 255));
-            return;
-        }
-
-        r = texture.data[index];
-        g = texture.data[index + 1];
-        b = texture.data[index + 2];
+        // Lighting only ever brightens nearest neighbour samples
+        r = std::min(static_cast<int>(texture.data[index] * std::max(lum.x, 1.0f)), 255);
+        g = std::min(static_cast<int>(texture.data[index + 1] * std::max(lum.y, 1.0f)), 255);
+        b = std::min(static_cast<int>(texture.data[index + 2] * std::max(lum.z, 1.0f)), 255);
     }
     // GL_LINEAR
     inline void texBilinear(
         const slib::texture& texture,
         bool textureAtlas,
         int tileSize,
-        float lum,
+        const slib::vec3& lum,
         float uvx,
         float uvy,
         int& r,
@@ -99,31 +90,43 @@ namespace sage
         float blue = ul * texture.data[topLeft + 2] + ll * texture.data[bottomLeft + 2] +
                      ur * texture.data[topRight + 2] + lr * texture.data[bottomRight + 2];
 
-        r = std::max(0, std::min(static_cast<int>(red * lum), 255));
-        g = std::max(0, std::min(static_cast<int>(green * lum), 255));
-        b = std::max(0, std::min(static_cast<int>(blue * lum), 255));
+        r = std::max(0, std::min(static_cast<int>(red * lum.x), 255));
+        g = std::max(0, std::min(static_cast<int>(green * lum.y), 255));
+        b = std::max(0, std::min(static_cast<int>(blue * lum.z), 255));
     }
 
-    inline void Rasterizer::drawPixel(float x, float y, const slib::vec3& coords, float lum) const
+    // The colour of the fragment at (x, y)
+    inline std::uint32_t Rasterizer::shade(float x, float y, const slib::vec3& coords, slib::vec3 lum) const
     {
-        // zBuffer.
-        float interpolated_z = coords.x * p1.z + coords.y * p2.z + coords.z * p3.z;
-        int zIndex = y * static_cast<int>(SCREEN_WIDTH) + x;
-        if (!(interpolated_z < zBuffer->buffer[zIndex] || zBuffer->buffer[zIndex] == 0)) return;
-        zBuffer->buffer[zIndex] = interpolated_z;
+        // "coords" are the barycentric coordinates of the current pixel, which are linear in screen space.
+        // Weighting them by 1/w gives the perspective-correct weights for attributes from view space.
+        const float pw1 = coords.x / viewW1;
+        const float pw2 = coords.y / viewW2;
+        const float pw3 = coords.z / viewW3;
+        const float wt = pw1 + pw2 + pw3;
 
         // Lighting
         if (fragmentShader == GOURAUD)
         {
             auto interpolated_normal = n1 * coords.x + n2 * coords.y + n3 * coords.z;
             interpolated_normal = smath::normalize(interpolated_normal);
-            lum = smath::dot(interpolated_normal, lightingDirection);
+            const auto worldPos = (w1 * pw1 + w2 * pw2 + w3 * pw3) / wt;
+            const float shadow =
+                shadowMap ? shadowMap->Visibility(worldPos, interpolated_normal, shadowMode == SHADOWS_PCF) : 1;
+            lum = lightGrid.Illuminate(
+                static_cast<int>(x), static_cast<int>(y), worldPos, interpolated_normal, shadow);
+        }
+        else if (fragmentShader == FLAT && shadowMap)
+        {
+            const auto worldPos = (w1 * pw1 + w2 * pw2 + w3 * pw3) / wt;
+            const float shadow = shadowMap->Visibility(worldPos, normal, shadowMode == SHADOWS_PCF);
+            lum = shadowedLum + (lum - shadowedLum) * shadow;
         }
 
         int r = 1, g = 1, b = 1;
 
         // If no texture.
-        if (material.map_Kd.data.empty())
+        if (!material.map_Kd)
         {
             float kdR = material.Kd[0];
             float kdG = material.Kd[1];
@@ -141,23 +144,16 @@ namespace sage
             g = (static_cast<int>(kdG * 255));
             b = (static_cast<int>(kdB * 255));
 
-            r = std::max(0, std::min(static_cast<int>(r * lum), 255));
-            g = std::max(0, std::min(static_cast<int>(g * lum), 255));
-            b = std::max(0, std::min(static_cast<int>(b * lum), 255));
+            r = std::max(0, std::min(static_cast<int>(r * lum.x), 255));
+            g = std::max(0, std::min(static_cast<int>(g * lum.y), 255));
+            b = std::max(0, std::min(static_cast<int>(b * lum.z), 255));
 
-            bufferPixels(surface, x, y, r, g, b);
-            return;
+            return packColor(r, g, b);
         }
 
         // Texturing
-        const auto at = slib::vec3({tx1.x, tx1.y, 1.0f}) / viewW1;
-        const auto bt = slib::vec3({tx2.x, tx2.y, 1.0f}) / viewW2;
-        const auto ct = slib::vec3({tx3.x, tx3.y, 1.0f}) / viewW3;
-        const float wt = coords.x * at.z + coords.y * bt.z + coords.z * ct.z;
-        // "coords" are the barycentric coordinates of the current pixel
-        // "at", "bt", "ct" are the texture coordinates of the corners of the current triangle
-        float uvx = (coords.x * at.x + coords.y * bt.x + coords.z * ct.x) / wt;
-        float uvy = (coords.x * at.y + coords.y * bt.y + coords.z * ct.y) / wt;
+        float uvx = (pw1 * tx1.x + pw2 * tx2.x + pw3 * tx3.x) / wt;
+        float uvy = (pw1 * tx1.y + pw2 * tx2.y + pw3 * tx3.y) / wt;
 
         // GL_CLAMP
         //    uvx = std::clamp(uvx, 0.0f, 1.0f);
@@ -176,15 +172,17 @@ namespace sage
         uvy = 1 - uvy;
 
         if (textureFilter == NEIGHBOUR)
-            texNearestNeighbour(material.map_Kd, lum, uvx, uvy, r, g, b);
+            texNearestNeighbour(*material.map_Kd, lum, uvx, uvy, r, g, b);
         else if (textureFilter == BILINEAR)
-            texBilinear(
-                material.map_Kd, renderable.mesh.atlas, renderable.mesh.atlasTileSize, lum, uvx, uvy, r, g, b);
+            texBilinear(*material.map_Kd, renderable.atlas, renderable.atlasTileSize, lum, uvx, uvy, r, g, b);
 
-        bufferPixels(surface, x, y, r, g, b);
+        return packColor(r, g, b);
     }
 
-    void Rasterizer::rasterizeTriangle(float area)
+    // Barycentric coordinates and depth of the sample at (x, y), if it's inside the triangle. Every single sampled
+    // path samples through here (and every multisampled one through coverage), so the depth-only prepass and the
+    // shading pass compute bit-identical depths and an equality test between them is safe.
+    inline bool Rasterizer::sample(float x, float y, float area, slib::vec3& coords, float& z) const
     {
         // Precalculate edge function
         const float EY1 = p3.y - p2.y;
@@ -192,7 +190,264 @@ namespace sage
         const float EY2 = p1.y - p3.y;
         const float EX2 = p1.x - p3.x;
 
-        float lum = 1;
+        coords.x = (x - p2.x) * EY1 - (y - p2.y) * EX1;
+        // signed area of the triangle v1v2p multiplied by 2
+        coords.y = (x - p3.x) * EY2 - (y - p3.y) * EX2;
+        // signed area of the triangle v2v0p multiplied by 2
+        coords.z = area - coords.x - coords.y;
+        // signed area of the triangle v0v1p multiplied by 2
+
+        if (coords.x < 0 || coords.y < 0 || coords.z < 0) return false;
+        coords /= area;
+        z = coords.x * p1.z + coords.y * p2.z + coords.z * p3.z;
+        return true;
+    }
+
+    // First row of column x to rasterize and the step between rows: every row, or every other one when
+    // checkerboarding
+    inline int Rasterizer::firstRow(int x, int& step) const
+    {
+        if (checkerboard < 0)
+        {
+            step = 1;
+            return bounds.ymin;
+        }
+        step = 2;
+        return bounds.ymin + ((x + bounds.ymin + checkerboard) & 1);
+    }
+
+    // Calls fragment(x, y, coords, z) for every pixel covered by the triangle.
+    template <typename Fragment>
+    inline void Rasterizer::forEachFragment(float area, Fragment fragment) const
+    {
+        slib::vec3 coords{};
+        float z;
+
+        // Iterate over every pixel in the triangle
+        for (int x = bounds.xmin; x <= bounds.xmax; ++x)
+        {
+            int step;
+            for (int y = firstRow(x, step); y <= bounds.ymax; y += step)
+            {
+                if (sample(x, y, area, coords, z)) fragment(x, y, coords, z);
+            }
+        }
+    }
+
+    // The tiny triangle path, for triangles whose bounds hold at most maxTinySamples pixels (as dense meshes in
+    // the distance break down into). Each of those pixels is tested directly, without the per-column setup of
+    // forEachFragment, and the covered ones are put in fragments. Returns how many there are.
+    inline int Rasterizer::tinyFragments(float area, TinyFragment (&fragments)[maxTinySamples]) const
+    {
+        const int width = bounds.xmax - bounds.xmin + 1;
+        const int count = bounds.Count();
+        int covered = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            const int x = bounds.xmin + i % width;
+            const int y = bounds.ymin + i / width;
+            if (checkerboard >= 0 && ((x + y) & 1) != checkerboard) continue;
+            auto& fragment = fragments[covered];
+            if (!sample(x, y, area, fragment.coords, fragment.z)) continue;
+            fragment.x = x;
+            fragment.y = y;
+            ++covered;
+        }
+        return covered;
+    }
+
+    template <DepthFormat format>
+    inline void Rasterizer::depthPass(float area) const
+    {
+        auto* depth = zBuffer->Data<format>();
+        auto write = [depth, width = screenWidth](int x, int y, float z) {
+            const auto encoded = DepthEncoding<format>::Encode(z);
+            auto& stored = depth[y * width + x];
+            if (encoded > stored) stored = encoded;
+        };
+
+        if (bounds.Count() <= maxTinySamples)
+        {
+            TinyFragment fragments[maxTinySamples];
+            const int count = tinyFragments(area, fragments);
+            for (int i = 0; i < count; ++i)
+                write(fragments[i].x, fragments[i].y, fragments[i].z);
+            return;
+        }
+        forEachFragment(area, [&write](int x, int y, const slib::vec3&, float z) { write(x, y, z); });
+    }
+
+    template <DepthFormat format>
+    inline void Rasterizer::shadePass(float area, bool depthPrepassed)
+    {
+        auto* depth = zBuffer->Data<format>();
+        auto visible = [this, depth, depthPrepassed](int x, int y, float z) {
+            if (reused && reused[y * screenWidth + x]) return false; // Already coloured from the last frame
+            const auto encoded = DepthEncoding<format>::Encode(z);
+            const auto stored = depth[y * screenWidth + x];
+            // The prepass already resolved visibility, so only the frontmost fragment is shaded. Otherwise it's
+            // reversed depth: larger is closer, and the cleared value (0) loses to everything.
+            return depthPrepassed ? encoded == stored : encoded > stored;
+        };
+        auto* pixels = static_cast<std::uint32_t*>(surface->pixels);
+
+        // Tiny triangles are often hidden entirely, so their few fragments are all depth tested before paying for
+        // the per-face lighting
+        if (bounds.Count() <= maxTinySamples)
+        {
+            TinyFragment fragments[maxTinySamples];
+            const int count = tinyFragments(area, fragments);
+            unsigned passed = 0;
+            for (int i = 0; i < count; ++i)
+                passed |= static_cast<unsigned>(visible(fragments[i].x, fragments[i].y, fragments[i].z)) << i;
+            if (!passed) return;
+            const slib::vec3 lum = faceLighting();
+            for (int i = 0; i < count; ++i)
+            {
+                if (!(passed >> i & 1)) continue;
+                const auto& fragment = fragments[i];
+                const int index = fragment.y * screenWidth + fragment.x;
+                depth[index] = DepthEncoding<format>::Encode(fragment.z);
+                pixels[index] = shade(fragment.x, fragment.y, fragment.coords, lum);
+            }
+            return;
+        }
+
+        const slib::vec3 lum = faceLighting();
+        auto fragment = [this, depth, pixels, &lum, &visible](int x, int y, const slib::vec3& coords, float z) {
+            if (!visible(x, y, z)) return;
+            depth[y * screenWidth + x] = DepthEncoding<format>::Encode(z);
+            pixels[y * screenWidth + x] = shade(x, y, coords, lum);
+        };
+        forEachFragment(area, fragment);
+    }
+
+    // Depths of the pixel's samples, and a mask of those inside the triangle (bit s for sample s). The same edge
+    // functions as sample, evaluated for all four samples at once without branches so that the loop vectorises.
+    inline unsigned Rasterizer::coverage(int x, int y, float area, float (&z)[msaaSamples]) const
+    {
+        const float EY1 = p3.y - p2.y;
+        const float EX1 = p3.x - p2.x;
+        const float EY2 = p1.y - p3.y;
+        const float EX2 = p1.x - p3.x;
+
+        int inside[msaaSamples];
+#pragma omp simd
+        for (int s = 0; s < msaaSamples; ++s)
+        {
+            const float sx = static_cast<float>(x) + msaaSampleOffsets[s][0];
+            const float sy = static_cast<float>(y) + msaaSampleOffsets[s][1];
+            const float c1 = (sx - p2.x) * EY1 - (sy - p2.y) * EX1;
+            const float c2 = (sx - p3.x) * EY2 - (sy - p3.y) * EX2;
+            const float c3 = area - c1 - c2;
+            inside[s] = c1 >= 0 && c2 >= 0 && c3 >= 0;
+            z[s] = (c1 * p1.z + c2 * p2.z + c3 * p3.z) / area;
+        }
+        unsigned mask = 0;
+        for (int s = 0; s < msaaSamples; ++s)
+            mask |= static_cast<unsigned>(inside[s]) << s;
+        return mask;
+    }
+
+    template <DepthFormat format>
+    inline void Rasterizer::msaaDepthPass(float area) const
+    {
+        auto* depth = zBuffer->Data<format>();
+        for (int y = bounds.ymin; y <= bounds.ymax; ++y)
+        {
+            for (int x = bounds.xmin; x <= bounds.xmax; ++x)
+            {
+                float z[msaaSamples];
+                const unsigned covered = coverage(x, y, area, z);
+                if (!covered) continue;
+                auto* stored = depth + (static_cast<std::size_t>(y) * screenWidth + x) * msaaSamples;
+                for (int s = 0; s < msaaSamples; ++s)
+                {
+                    const auto encoded = DepthEncoding<format>::Encode(z[s]);
+                    if ((covered >> s & 1) && encoded > stored[s]) stored[s] = encoded;
+                }
+            }
+        }
+    }
+
+    template <DepthFormat format>
+    inline void Rasterizer::msaaShadePass(float area, bool depthPrepassed)
+    {
+        auto* depth = zBuffer->Data<format>();
+        // Lit on the first visible sample, so hidden triangles never pay for it (as the tiny triangle path does)
+        bool lit = false;
+        slib::vec3 lum{};
+        for (int y = bounds.ymin; y <= bounds.ymax; ++y)
+        {
+            for (int x = bounds.xmin; x <= bounds.xmax; ++x)
+            {
+                float z[msaaSamples];
+                const unsigned covered = coverage(x, y, area, z);
+                if (!covered) continue;
+                const auto pixel = (static_cast<std::size_t>(y) * screenWidth + x) * msaaSamples;
+                auto* stored = depth + pixel;
+                unsigned visible = 0;
+                for (int s = 0; s < msaaSamples; ++s)
+                {
+                    const auto encoded = DepthEncoding<format>::Encode(z[s]);
+                    const bool passed = depthPrepassed ? encoded == stored[s] : encoded > stored[s];
+                    if ((covered >> s & 1) && passed) visible |= 1u << s;
+                }
+                if (!visible) continue;
+                if (!lit)
+                {
+                    lum = faceLighting();
+                    lit = true;
+                }
+
+                // Shaded once, at the pixel's centre, or at a visible sample if the centre is outside the triangle
+                // (so attributes are never extrapolated past its edges)
+                slib::vec3 coords{};
+                float centreZ;
+                if (!sample(x, y, area, coords, centreZ))
+                {
+                    const int s = std::countr_zero(visible);
+                    sample(x + msaaSampleOffsets[s][0], y + msaaSampleOffsets[s][1], area, coords, centreZ);
+                }
+                const std::uint32_t color = shade(x, y, coords, lum);
+                for (int s = 0; s < msaaSamples; ++s)
+                {
+                    if (!(visible >> s & 1)) continue;
+                    stored[s] = DepthEncoding<format>::Encode(z[s]);
+                    sampleColor[pixel + s] = color;
+                }
+            }
+        }
+    }
+
+    void Rasterizer::rasterizeDepth(float area) const
+    {
+        switch (zBuffer->Format())
+        {
+        case DEPTH_32F:
+            if (sampleColor)
+                msaaDepthPass<DEPTH_32F>(area);
+            else
+                depthPass<DEPTH_32F>(area);
+            break;
+        case DEPTH_24:
+            if (sampleColor)
+                msaaDepthPass<DEPTH_24>(area);
+            else
+                depthPass<DEPTH_24>(area);
+            break;
+        case DEPTH_16:
+            if (sampleColor)
+                msaaDepthPass<DEPTH_16>(area);
+            else
+                depthPass<DEPTH_16>(area);
+            break;
+        }
+    }
+
+    slib::vec3 Rasterizer::faceLighting()
+    {
+        slib::vec3 lum{1, 1, 1};
         // Precalculate lighting (flat shading)
         if (fragmentShader == FLAT)
         {
@@ -204,39 +459,38 @@ namespace sage
             // data present
             //}
 
-            lum = smath::dot(normal, lightingDirection);
+            // The whole face is lit once, at its centroid, with the lights of the tile under its screen centroid
+            const int cx = std::clamp(static_cast<int>((p1.x + p2.x + p3.x) / 3), 0, screenWidth - 1);
+            const int cy = std::clamp(static_cast<int>((p1.y + p2.y + p3.y) / 3), 0, screenHeight - 1);
+            const auto centroid = (w1 + w2 + w3) / 3.0f;
+            lum = lightGrid.Illuminate(cx, cy, centroid, normal);
+            if (shadowMap) shadowedLum = lightGrid.Illuminate(cx, cy, centroid, normal, 0);
         }
+        return lum;
+    }
 
-        // Get bounding box.
-        const int xmin = std::max(static_cast<int>(std::floor(std::min({p1.x, p2.x, p3.x}))), 0);
-        const int xmax =
-            std::min(static_cast<int>(std::ceil(std::max({p1.x, p2.x, p3.x}))), static_cast<int>(SCREEN_WIDTH));
-        const int ymin = std::max(static_cast<int>(std::floor(std::min({p1.y, p2.y, p3.y}))), 0);
-        const int ymax =
-            std::min(static_cast<int>(std::ceil(std::max({p1.y, p2.y, p3.y}))), static_cast<int>(SCREEN_HEIGHT));
-
-        slib::vec3 coords{};
-
-        // Iterate over every pixel in the triangle
-        // #pragma omp parallel for default(none) shared(xmin, xmax, ymin, ymax, area, EY1, EY2, EX1, EX2, coords,
-        // lum)
-        for (int x = xmin; x <= xmax; ++x)
+    void Rasterizer::rasterizeTriangle(float area, bool depthPrepassed)
+    {
+        switch (zBuffer->Format())
         {
-            for (int y = ymin; y <= ymax; ++y)
-            {
-                coords.x = (x - p2.x) * EY1 - (y - p2.y) * EX1;
-                // signed area of the triangle v1v2p multiplied by 2
-                coords.y = (x - p3.x) * EY2 - (y - p3.y) * EX2;
-                // signed area of the triangle v2v0p multiplied by 2
-                coords.z = area - coords.x - coords.y;
-                // signed area of the triangle v0v1p multiplied by 2
-
-                if (coords.x >= 0 && coords.y >= 0 && coords.z >= 0)
-                {
-                    coords /= area;
-                    drawPixel(x, y, coords, lum);
-                }
-            }
+        case DEPTH_32F:
+            if (sampleColor)
+                msaaShadePass<DEPTH_32F>(area, depthPrepassed);
+            else
+                shadePass<DEPTH_32F>(area, depthPrepassed);
+            break;
+        case DEPTH_24:
+            if (sampleColor)
+                msaaShadePass<DEPTH_24>(area, depthPrepassed);
+            else
+                shadePass<DEPTH_24>(area, depthPrepassed);
+            break;
+        case DEPTH_16:
+            if (sampleColor)
+                msaaShadePass<DEPTH_16>(area, depthPrepassed);
+            else
+                shadePass<DEPTH_16>(area, depthPrepassed);
+            break;
         }
     }
-} // namespace sage
\ No newline at end of file
+} // namespace sage
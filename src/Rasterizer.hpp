@@ -4,13 +4,19 @@
 
 #pragma once
 
+#include "LightGrid.hpp"
 #include "Renderable.hpp"
+#include "ShadowMap.hpp"
 #include "ZBuffer.hpp"
 
 #include "slib.hpp"
 #include "smath.hpp"
 #include <SDL2/SDL.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
 namespace sage
 {
 
@@ -27,21 +33,103 @@ namespace sage
         BILINEAR
     };
 
+    enum ShadowMode
+    {
+        SHADOWS_OFF,
+        SHADOWS_HARD,
+        SHADOWS_PCF
+    };
+
+    // 4x multisampling: each pixel's samples, as offsets from its centre (its integer screen coordinates). A
+    // rotated grid (the D3D standard pattern), so edges near horizontal and near vertical both get four steps.
+    inline constexpr int msaaSamples = 4;
+    inline constexpr float msaaSampleOffsets[msaaSamples][2] = {
+        {-0.125f, -0.375f}, {0.375f, -0.125f}, {-0.375f, 0.125f}, {0.125f, 0.375f}};
+    // The furthest any sample lies from its pixel's centre along either axis
+    inline constexpr float msaaReach = 0.375f;
+
+    // The pixels (integer screen coordinates) inside a triangle's bounding box grown by margin, clipped to the
+    // screen. With a margin of 0 that's the pixel centres inside it, and it's empty when the triangle falls
+    // between them, in which case it can't cover any pixel. Multisampling passes msaaReach, to include every
+    // pixel with a sample inside.
+    struct SampleBounds
+    {
+        int xmin, xmax, ymin, ymax;
+
+        bool Empty() const
+        {
+            return xmin > xmax || ymin > ymax;
+        }
+
+        int Count() const
+        {
+            return Empty() ? 0 : (xmax - xmin + 1) * (ymax - ymin + 1);
+        }
+
+        SampleBounds Intersect(const SampleBounds& other) const
+        {
+            return {
+                std::max(xmin, other.xmin),
+                std::min(xmax, other.xmax),
+                std::max(ymin, other.ymin),
+                std::min(ymax, other.ymax)};
+        }
+    };
+
+    inline SampleBounds sampleBounds(
+        const slib::vec3& p1, const slib::vec3& p2, const slib::vec3& p3, int width, int height, float margin = 0)
+    {
+        // Clamped as floats so that far off-screen vertices can't overflow the conversion to int
+        auto first = [](float min, int size) {
+            return static_cast<int>(std::clamp(std::ceil(min), 0.0f, static_cast<float>(size)));
+        };
+        auto last = [](float max, int size) {
+            return static_cast<int>(std::clamp(std::floor(max), -1.0f, static_cast<float>(size - 1)));
+        };
+        return {
+            first(std::min({p1.x, p2.x, p3.x}) - margin, width),
+            last(std::max({p1.x, p2.x, p3.x}) + margin, width),
+            first(std::min({p1.y, p2.y, p3.y}) - margin, height),
+            last(std::max({p1.y, p2.y, p3.y}) + margin, height)};
+    }
+
     class Rasterizer
     {
+        // Triangles whose bounds hold at most this many samples take the tiny triangle path (see tinyFragments)
+        static constexpr int maxTinySamples = 4;
+        // For triangles without a material
+        static inline const slib::material noMaterial{};
+
         SDL_Surface* const surface;
-        ZBuffer* const zBuffer;
+        // The framebuffer's per sample colours when multisampling (see Framebuffer), otherwise nullptr
+        std::uint32_t* const sampleColor;
+        // Per pixel, non-zero where the colour was reused from the last frame and needs no shading (see
+        // TemporalCache). nullptr when nothing is reused.
+        const std::uint8_t* const reused;
+        // Checkerboard rendering: only pixels with (x + y) % 2 equal to this are rasterized. -1 rasterizes all.
+        const int checkerboard;
+        // Framebuffer size (the colour and depth buffers match)
+        const int screenWidth;
+        const int screenHeight;
+        ZBuffer* const zBuffer; // msaaSamples depths per pixel when multisampling
         // The triangle being rasterized
         const slib::tri& t;
         const Renderable& renderable;
 
-        const slib::vec3 lightingDirection{1, 1, 1.5};
+        const LightGrid& lightGrid;
+        // nullptr when shadows are off
+        const ShadowMap* const shadowMap;
         slib::vec3 normal{};
+        // Flat shading lighting with the shadow caster fully occluded
+        slib::vec3 shadowedLum{};
 
         // Screen points of each vertex
         const slib::vec3& p1;
         const slib::vec3& p2;
         const slib::vec3& p3;
+        // The pixels the triangle may cover, within the region passed in (all of the framebuffer, or a dirty
+        // rectangle being redrawn)
+        const SampleBounds bounds;
 
         // Texture coordinates of each vertex
         const slib::vec2& tx1;
@@ -60,39 +148,93 @@ namespace sage
         const slib::vec3& n2;
         const slib::vec3& n3;
 
+        // World space position of each vertex (used for point/spot lighting)
+        const slib::vec3& w1;
+        const slib::vec3& w2;
+        const slib::vec3& w3;
+
         const FragmentShader fragmentShader;
         const TextureFilter textureFilter;
-
-        void drawPixel(float x, float y, const slib::vec3& coords, float lum) const;
+        const ShadowMode shadowMode;
+
+        std::uint32_t shade(float x, float y, const slib::vec3& coords, slib::vec3 lum) const;
+        slib::vec3 faceLighting();
+        bool sample(float x, float y, float area, slib::vec3& coords, float& z) const;
+        unsigned coverage(int x, int y, float area, float (&z)[msaaSamples]) const;
+        int firstRow(int x, int& step) const;
+        template <typename Fragment>
+        void forEachFragment(float area, Fragment fragment) const;
+
+        // A covered pixel of a tiny triangle
+        struct TinyFragment
+        {
+            int x, y;
+            slib::vec3 coords;
+            float z;
+        };
+        int tinyFragments(float area, TinyFragment (&fragments)[maxTinySamples]) const;
+        template <DepthFormat format>
+        void depthPass(float area) const;
+        template <DepthFormat format>
+        void shadePass(float area, bool depthPrepassed);
+        template <DepthFormat format>
+        void msaaDepthPass(float area) const;
+        template <DepthFormat format>
+        void msaaShadePass(float area, bool depthPrepassed);
 
       public:
-        void rasterizeTriangle(float area);
+        // Depth-only rasterization for the Z-prepass. Writes the zBuffer without shading.
+        void rasterizeDepth(float area) const;
+        // With depthPrepassed set, the zBuffer already holds the final depths (see rasterizeDepth) and only
+        // fragments that match them are shaded. When multisampling, coverage and depth are tested per sample but
+        // each pixel is shaded once, and its colour stored to the samples that passed.
+        void rasterizeTriangle(float area, bool depthPrepassed = false);
 
         Rasterizer(
             ZBuffer* const _zBuffer,
             const Renderable& _renderable,
             const slib::tri& _t,
+            const LightGrid& _lightGrid,
+            const ShadowMap* const _shadowMap,
             SDL_Surface* const _surface,
+            std::uint32_t* const _sampleColor,
+            const std::uint8_t* const _reused,
+            int _checkerboard,
+            const SampleBounds& _region,
             FragmentShader _fragmentShader,
-            TextureFilter _textureFilter)
+            TextureFilter _textureFilter,
+            ShadowMode _shadowMode)
             : surface(_surface),
+              sampleColor(_sampleColor),
+              reused(_reused),
+              checkerboard(_checkerboard),
+              screenWidth(_surface->w),
+              screenHeight(_surface->h),
               zBuffer(_zBuffer),
               t(_t),
               renderable(_renderable),
+              lightGrid(_lightGrid),
+              shadowMap(_shadowMap),
               p1(t.v1.screenPoint),
               p2(t.v2.screenPoint),
               p3(t.v3.screenPoint),
+              bounds(sampleBounds(p1, p2, p3, screenWidth, screenHeight, _sampleColor ? msaaReach : 0)
+                         .Intersect(_region)),
               tx1(t.v1.textureCoords),
               tx2(t.v2.textureCoords),
               tx3(t.v3.textureCoords),
-              material(renderable.mesh.materials.at(t.material)),
+              material(t.material >= 0 ? renderable.mesh->materials[t.material] : noMaterial),
               viewW1(t.v1.projectedPoint.w),
               viewW2(t.v2.projectedPoint.w),
               viewW3(t.v3.projectedPoint.w),
               n1(t.v1.normal),
               n2(t.v2.normal),
               n3(t.v3.normal),
+              w1(t.v1.worldPoint),
+              w2(t.v2.worldPoint),
+              w3(t.v3.worldPoint),
               fragmentShader(_fragmentShader),
-              textureFilter(_textureFilter){};
+              textureFilter(_textureFilter),
+              shadowMode(_shadowMode){};
     };
 } // namespace sage
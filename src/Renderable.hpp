@@ -5,20 +5,23 @@
 #pragma once
 
 #include "Mesh.hpp"
+#include <memory>
 #include <utility>
 
 namespace sage
 {
     struct Renderable
     {
-        const Mesh mesh;
+        const std::shared_ptr<const Mesh> mesh;
         slib::vec3 position;
         slib::vec3 eulerAngles;
         slib::vec3 scale;
         slib::Color col;
         bool ignoreLighting = false;
+        bool atlas = false; // Does the mesh use a texture atlas (requires 'tiles' of a consistent size)
+        int atlasTileSize = 32;
         Renderable(
-            Mesh _mesh,
+            std::shared_ptr<const Mesh> _mesh,
             const slib::vec3& _position,
             const slib::vec3& _eulerAngles,
             const slib::vec3& _scale,
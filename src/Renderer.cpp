@@ -9,6 +9,11 @@
 #include "Renderable.hpp"
 #include "ZBuffer.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
 namespace sage
 {
 
@@ -38,60 +43,42 @@ namespace sage
         // next.
     }
 
-    inline void createScreenSpace(std::vector<slib::tri>& faces)
+    inline void createScreenSpace(slib::tri& f, float nearW, float width, float height)
     {
         // Convert to screen
-#pragma omp parallel for default(none) shared(faces, SCREEN_WIDTH, SCREEN_HEIGHT)
-        for (auto& f : faces)
+        if (!makeClipSpace(f))
         {
-            if (!makeClipSpace(f))
+            f.skip = true;
+            return;
+        }
+        auto ndc = [nearW, width, height](auto& v, auto& screen) {
+            // Reversed depth (see ZBuffer.hpp). 1/w is linear in screen space, so this interpolates correctly.
+            const float depth = nearW / v.w;
+
+            // NDC Space
+            if (v.w != 0)
             {
-                f.skip = true;
-                continue;
+                // Perspective divide
+                v.x /= v.w;
+                v.y /= v.w;
+                v.z /= v.w;
             }
-            auto ndc = [](auto& v, auto& screen) {
-                // NDC Space
-                if (v.w != 0)
-                {
-                    // Perspective divide
-                    v.x /= v.w;
-                    v.y /= v.w;
-                    v.z /= v.w;
-                }
-                //-----------------------------
-
-                // Screen space
-                const auto x1 = static_cast<float>(SCREEN_WIDTH / 2 + v.x * SCREEN_WIDTH / 2);
-                const auto y1 = static_cast<float>(SCREEN_HEIGHT / 2 - v.y * SCREEN_HEIGHT / 2);
-                screen = {x1, y1, v.z};
-            };
-            ndc(f.v1.projectedPoint, f.v1.screenPoint);
-            ndc(f.v2.projectedPoint, f.v2.screenPoint);
-            ndc(f.v3.projectedPoint, f.v3.screenPoint);
-        }
-#pragma omp barrier
-    }
+            //-----------------------------
 
-    inline void Renderer::clearBuffer() const
-    {
-        auto* pixels = static_cast<unsigned char*>(sdlSurface->pixels);
-#pragma omp parallel for default(none) shared(pixels)
-        for (int i = 0; i < screenSize * 4; ++i)
-            pixels[i] = 0;
-#pragma omp barrier
+            // Screen space
+            const auto x1 = width / 2 + v.x * width / 2;
+            const auto y1 = height / 2 - v.y * height / 2;
+            screen = {x1, y1, depth};
+        };
+        ndc(f.v1.projectedPoint, f.v1.screenPoint);
+        ndc(f.v2.projectedPoint, f.v2.screenPoint);
+        ndc(f.v3.projectedPoint, f.v3.screenPoint);
     }
 
-    void Renderer::RenderBuffer() const
+    void Renderer::RenderBuffer()
     {
         SDL_RenderPresent(sdlRenderer);
-        clearBuffer();
-    }
-
-    inline void pushBuffer(SDL_Renderer* renderer, SDL_Surface* surface)
-    {
-        SDL_Texture* tex = SDL_CreateTextureFromSurface(renderer, surface);
-        SDL_RenderCopy(renderer, tex, nullptr, nullptr);
-        SDL_DestroyTexture(tex);
+        finishFrame();
     }
 
     inline void Renderer::updateViewMatrix()
@@ -102,11 +89,19 @@ namespace sage
         camera.UpdateDirectionVectors(viewMatrix);
     }
 
-    inline void createProjectedSpace(
+    // Decodes and transforms each vertex of geometry once (into vertices), then assembles its triangles into faces
+    // and takes them through to screen space. Both passes are split across the workers.
+    inline void transformFaces(
+        JobSystem& jobs,
         const Renderable& renderable,
         const slib::mat4& viewMatrix,
         const slib::mat4& perspectiveMat,
-        std::vector<slib::tri>& faces)
+        float nearW,
+        float width,
+        float height,
+        const MeshGeometry& geometry,
+        std::span<slib::vertex> vertices,
+        std::span<slib::tri> faces)
     {
         const slib::mat4 scaleMatrix = smath::scale({renderable.scale.x, renderable.scale.y, renderable.scale.z});
         const slib::mat4 rotationMatrix = smath::rotation(renderable.eulerAngles);
@@ -118,62 +113,530 @@ namespace sage
             rotationMatrix * scaleMatrix; // Normal transforms do not need to be translated
         const slib::mat4 fullTransformMat = translationMatrix * normalTransformMat;
         const auto viewTransform = viewMatrix * fullTransformMat;
+        const VertexQuantization& quantization = renderable.mesh->quantization;
+
+        jobs.ParallelFor(geometry.vertices.size(), 512, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const PackedVertex& packed = geometry.vertices[i];
+                auto& v = vertices[i];
+                v.position = quantization.DecodePosition(packed);
+                v.textureCoords = quantization.DecodeTextureCoords(packed);
+                v.normal = normalTransformMat * slib::vec4(VertexQuantization::DecodeNormal(packed), 0);
+                v.worldPoint = fullTransformMat * slib::vec4(v.position, 1);
+                v.projectedPoint = viewTransform * slib::vec4(v.position, 1) * perspectiveMat;
+            }
+        });
+        jobs.ParallelFor(faces.size(), 256, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const std::uint32_t* index = &geometry.indices[i * 3];
+                auto& f = faces[i];
+                f.skip = false;
+                f.v1 = vertices[index[0]];
+                f.v2 = vertices[index[1]];
+                f.v3 = vertices[index[2]];
+                f.material = geometry.materials[i];
+                createScreenSpace(f, nearW, width, height);
+            }
+        });
+    }
+
+    // Level lod of the mesh, where 0 is the full mesh and level i is mesh.lods[i - 1]
+    inline const MeshGeometry& lodGeometry(const Mesh& mesh, int lod)
+    {
+        return lod == 0 ? mesh.geometry : mesh.lods[lod - 1].geometry;
+    }
+
+    int Renderer::selectLod(const Mesh& mesh, float viewX, float viewY, float viewZ, float scale) const
+    {
+        if (lodThreshold <= 0 || mesh.lods.empty()) return 0;
+        // Pixels per unit at the nearest the model's bounding sphere gets to the camera, from the clip space w
+        // there and the projection's y scale. That point is the radius nearer along the view axis (towards +z),
+        // and goes through the projection like any other. The full mesh is drawn while the camera is (nearly)
+        // inside the sphere.
+        const auto& p = perspectiveMat.data;
+        const float nearestZ = viewZ + mesh.boundingRadius * scale;
+        const float w = p[3][0] * viewX + p[3][1] * viewY + p[3][2] * nearestZ + p[3][3];
+        if (w <= nearW) return 0;
+        const float pixelsPerUnit = scale * p[1][1] * static_cast<float>(framebuffer->Height()) / (2 * w);
+        int lod = 0;
+        while (lod < static_cast<int>(mesh.lods.size()) && mesh.lods[lod].error * pixelsPerUnit <= lodThreshold)
+            ++lod;
+        return lod;
+    }
+
+    inline void Renderer::rasterizeFace(
+        const Renderable& renderable, const slib::tri& f, bool shadows, RasterPass pass)
+    {
+        if (f.skip) return;
+        const auto& p1 = f.v1.screenPoint;
+        const auto& p2 = f.v2.screenPoint;
+        const auto& p3 = f.v3.screenPoint;
+
+        const float area = (p3.x - p1.x) * (p2.y - p1.y) -
+                           (p3.y - p1.y) * (p2.x - p1.x); // area of the triangle multiplied by 2
+        if (area < 0) return;                             // Backface culling
+        // Triangles that fall between pixel samples (or outside the region) are dropped before any rasterizer
+        // setup
+        const float margin = framebuffer->Samples() > 1 ? msaaReach : 0;
+        const SampleBounds bounds = sampleBounds(p1, p2, p3, framebuffer->Width(), framebuffer->Height(), margin);
+        if (bounds.Intersect(region).Empty()) return;
+        Rasterizer rasterizer(
+            framebuffer->Depth(),
+            renderable,
+            f,
+            lightGrid,
+            shadows ? &shadowMap : nullptr,
+            framebuffer->Surface(),
+            framebuffer->SampleColor(),
+            reusedPixels,
+            checkerboardParity,
+            region,
+            fragmentShader,
+            textureFilter,
+            shadowMode);
+        if (pass == DEPTH_ONLY)
+            rasterizer.rasterizeDepth(area);
+        else
+            rasterizer.rasterizeTriangle(area, pass == SHADE_EQUAL);
+    }
+
+    void Renderer::rasterizeFaces(
+        const Renderable& renderable, std::span<const slib::tri> faces, bool shadows, RasterPass pass)
+    {
+        // Triangles vary wildly in size, so they're handed out in small batches for the workers to balance
+        jobs.ParallelFor(faces.size(), 32, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                rasterizeFace(renderable, faces[i], shadows, pass);
+        });
+    }
+
+    void Renderer::cullInstances(
+        const InstancedRenderable& instanced,
+        FrameArena& arena,
+        std::span<std::uint32_t>& visible,
+        std::span<std::uint8_t>& lods)
+    {
+        // Bounding spheres against the frustum, over the structure of arrays so the loop vectorises. The view
+        // matrix is applied the way transformFaces applies it (its transpose, see slib::mat4::operator*).
+        const auto& v = viewMatrix.data;
+        const float v00 = v[0][0], v10 = v[1][0], v20 = v[2][0], v30 = v[3][0];
+        const float v01 = v[0][1], v11 = v[1][1], v21 = v[2][1], v31 = v[3][1];
+        const float v02 = v[0][2], v12 = v[1][2], v22 = v[2][2], v32 = v[3][2];
+        const auto planes = frustumPlanes;
+        const float* bx = instanced.BoundsX();
+        const float* by = instanced.BoundsY();
+        const float* bz = instanced.BoundsZ();
+        const float* radius = instanced.BoundsRadius();
+        const auto count = instanced.Count();
+        std::uint8_t* mask = arena.Allocate<std::uint8_t>(count).data();
+#pragma omp simd
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float x = v00 * bx[i] + v10 * by[i] + v20 * bz[i] + v30;
+            const float y = v01 * bx[i] + v11 * by[i] + v21 * bz[i] + v31;
+            const float z = v02 * bx[i] + v12 * by[i] + v22 * bz[i] + v32;
+            bool inside = true;
+            for (const auto& plane : planes)
+                inside &= plane.x * x + plane.y * y + plane.z * z + plane.w >= -radius[i];
+            mask[i] = inside;
+        }
+
+        visible = arena.Allocate<std::uint32_t>(count);
+        lods = arena.Allocate<std::uint8_t>(count);
+        std::size_t visibleCount = 0;
+        const float meshRadius = instanced.mesh->boundingRadius;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!mask[i]) continue;
+            visible[visibleCount] = static_cast<std::uint32_t>(i);
+            const float x = v00 * bx[i] + v10 * by[i] + v20 * bz[i] + v30;
+            const float y = v01 * bx[i] + v11 * by[i] + v21 * bz[i] + v31;
+            const float z = v02 * bx[i] + v12 * by[i] + v22 * bz[i] + v32;
+            // The bounds radius is the mesh's radius times the instance's largest scale
+            const float scale = meshRadius > 0 ? radius[i] / meshRadius : 1;
+            lods[visibleCount++] = static_cast<std::uint8_t>(selectLod(*instanced.mesh, x, y, z, scale));
+        }
+        visible = visible.first(visibleCount);
+        lods = lods.first(visibleCount);
+    }
+
+    void Renderer::drawInstances(bool shadows, RasterPass pass)
+    {
+        // Each visible instance is transformed into the same scratch buffer and drawn straight away. The depth
+        // prepass and shading pass transform it identically, so their depths still match exactly.
+        for (size_t i = 0; i < instancedRenderables.size(); ++i)
+        {
+            for (size_t j = 0; j < visibleInstances[i].size(); ++j)
+            {
+                const Renderable instance = instancedRenderables[i]->Instance(visibleInstances[i][j]);
+                const MeshGeometry& geometry = lodGeometry(*instance.mesh, visibleInstanceLods[i][j]);
+                const auto faces = instanceFaces.first(geometry.TriangleCount());
+                transformFaces(
+                    jobs,
+                    instance,
+                    viewMatrix,
+                    perspectiveMat,
+                    nearW,
+                    static_cast<float>(framebuffer->Width()),
+                    static_cast<float>(framebuffer->Height()),
+                    geometry,
+                    instanceVertices,
+                    faces);
+                rasterizeFaces(instance, faces, shadows, pass);
+            }
+        }
+    }
 
-#pragma omp parallel for default(none)                                                                            \
-    shared(renderable, viewMatrix, perspectiveMat, faces, normalTransformMat, viewTransform)
-        for (auto& f : faces)
+    void Renderer::updateShadowCasters()
+    {
+        instanceCasters.clear();
+        for (const auto* instanced : instancedRenderables)
         {
-            f.v1.projectedPoint = viewTransform * slib::vec4(f.v1.position, 1) * perspectiveMat;
-            f.v1.normal = normalTransformMat * slib::vec4(f.v1.normal, 0);
-            f.v2.projectedPoint = viewTransform * slib::vec4(f.v2.position, 1) * perspectiveMat;
-            f.v2.normal = normalTransformMat * slib::vec4(f.v2.normal, 0);
-            f.v3.projectedPoint = viewTransform * slib::vec4(f.v3.position, 1) * perspectiveMat;
-            f.v3.normal = normalTransformMat * slib::vec4(f.v3.normal, 0);
+            for (size_t i = 0; i < instanced->Count(); ++i)
+                instanceCasters.push_back(instanced->Instance(i));
         }
-#pragma omp barrier
+        shadowCasters = renderables;
+        for (const auto& caster : instanceCasters)
+            shadowCasters.push_back(&caster);
+        shadowCastersDirty = false;
     }
 
     void Renderer::Render()
     {
-        zBuffer->clear();
+        finishFrame();
+        // Everything the frame reads from outside the renderer is captured here, on the calling thread. The
+        // camera in particular may be moved (or a scene loaded) while the frame renders.
         updateViewMatrix();
-        for (const auto& renderable : renderables)
+        const bool prepass = zPrepass;
+        const bool temporal = temporalReuse;
+        const bool checkerboarded = checkerboard;
+        captureFrameState(nextFrameState);
+
+        // Nothing changed since the frame in presented: once it has settled, it stays on screen and nothing is
+        // rendered
+        const bool unchanged =
+            nextFrameState.Changes(frameState(*presented), dirtyRegions) && dirtyRegions.empty();
+        stillFrames = unchanged ? std::min(stillFrames + 1, settleFrames) : 0;
+        idle = unchanged && stillFrames >= (temporal || checkerboarded ? settleFrames : 1);
+        if (!idle)
+        {
+            // framebuffer holds the frame before that. Where only renderables moved since, just the regions they
+            // moved over are redrawn. Multisampling, temporal reuse and checkerboarding blend in other frames (or
+            // samples), so they always redraw everything.
+            const bool partial = !temporal && !checkerboarded && framebuffer->Samples() == 1 &&
+                                 nextFrameState.Changes(frameState(*framebuffer), dirtyRegions);
+            std::swap(frameState(*framebuffer), nextFrameState);
+            frameInFlight = framePool.Submit([this, prepass, temporal, checkerboarded, partial] {
+                renderFrame(prepass, temporal, checkerboarded, partial);
+            });
+        }
+
+        // The previous frame goes to the screen while this one renders. If it couldn't be uploaded, its texture
+        // still holds an older frame, so the upload is tried again next time rather than redrawing that.
+        if (presentPending)
+            presentPending = !presented->Present(sdlRenderer, jobs);
+        else
+            presented->Redraw(sdlRenderer);
+    }
+
+    bool Renderer::Idle() const
+    {
+        return idle;
+    }
+
+    FrameState& Renderer::frameState(const Framebuffer& buffer)
+    {
+        return frameStates[&buffer - framebuffers];
+    }
+
+    void Renderer::captureFrameState(FrameState& state) const
+    {
+        state.valid = true;
+        state.generation = generation;
+        state.view = viewMatrix;
+        state.width = framebuffer->Width();
+        state.height = framebuffer->Height();
+        state.prepass = zPrepass;
+        state.temporal = temporalReuse;
+        state.checkerboard = checkerboard;
+        state.shadows = shadowMode != SHADOWS_OFF && std::any_of(lights.begin(), lights.end(), [](const Light* l) {
+                            return l->type == DIRECTIONAL && l->castsShadows;
+                        });
+        state.renderables.clear();
+        for (const auto* renderable : renderables)
+        {
+            state.renderables.push_back(
+                {renderable,
+                 renderable->position,
+                 renderable->eulerAngles,
+                 renderable->scale,
+                 renderable->col,
+                 renderable->ignoreLighting,
+                 screenBounds(*renderable)});
+        }
+        state.instanced.clear();
+        for (const auto* instanced : instancedRenderables)
+            state.instanced.push_back({instanced, instanced->Version()});
+        state.lights.clear();
+        for (const auto* light : lights)
+            state.lights.push_back(*light);
+    }
+
+    SampleBounds Renderer::screenBounds(const Renderable& renderable) const
+    {
+        // The box around the renderable's bounding sphere in view space, projected like transformFaces projects
+        // vertices. If any of it is behind the near plane it's taken to cover the whole screen.
+        const auto& s = renderable.scale;
+        const slib::mat4 modelMatrix =
+            smath::translation({renderable.position.x, renderable.position.y, renderable.position.z}) *
+            (smath::rotation(renderable.eulerAngles) * smath::scale({s.x, s.y, s.z}));
+        const slib::vec4 origin = (viewMatrix * modelMatrix) * slib::vec4(0, 0, 0, 1);
+        const float radius =
+            renderable.mesh->boundingRadius * std::max({std::abs(s.x), std::abs(s.y), std::abs(s.z)});
+        const int width = framebuffer->Width();
+        const int height = framebuffer->Height();
+        float xmin = std::numeric_limits<float>::max(), ymin = xmin;
+        float xmax = -xmin, ymax = -xmin;
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            const slib::vec4 clip =
+                slib::vec4(
+                    origin.x + (corner & 1 ? radius : -radius),
+                    origin.y + (corner & 2 ? radius : -radius),
+                    origin.z + (corner & 4 ? radius : -radius),
+                    1) *
+                perspectiveMat;
+            if (clip.w < nearW) return {0, width - 1, 0, height - 1};
+            const float x = width / 2.0f + clip.x / clip.w * width / 2.0f;
+            const float y = height / 2.0f - clip.y / clip.w * height / 2.0f;
+            xmin = std::min(xmin, x);
+            xmax = std::max(xmax, x);
+            ymin = std::min(ymin, y);
+            ymax = std::max(ymax, y);
+        }
+        // The pixels inside, as for a triangle over the box, with one to spare for rounding
+        return sampleBounds({xmin, ymin, 0}, {xmax, ymax, 0}, {xmin, ymax, 0}, width, height, 1);
+    }
+
+    void Renderer::renderFrame(bool prepass, bool temporal, bool checkerboarded, bool partial)
+    {
+        // Reprojection needs every pixel's final depth, so it runs the prepass. Checkerboarding is the cheaper
+        // alternative, so it gives way to temporal reuse.
+        temporal = temporal && framebuffer->Samples() == 1;
+        prepass = prepass || temporal;
+        checkerboarded = checkerboarded && framebuffer->Samples() == 1 && !temporal;
+        if (checkerboarded)
         {
-            std::vector<slib::tri> faces = renderable->mesh.faces;
-            createProjectedSpace(*renderable, viewMatrix, perspectiveMat, faces);
-            createScreenSpace(faces);
+            checkerboardFill.Begin();
+            checkerboardParity = static_cast<int>(checkerboardFill.Parity());
+        }
+
+        // Setup for the raster passes, as a graph so that independent stages overlap. Each renderable's
+        // transform is itself split across the workers.
+        TaskGraph setup;
+        setup.Add([this, partial] {
+            if (!partial)
+            {
+                framebuffer->Clear(jobs);
+                return;
+            }
+            for (const auto& dirty : dirtyRegions)
+                framebuffer->Clear(dirty.xmin, dirty.ymin, dirty.xmax, dirty.ymax, jobs);
+        });
+        const auto buildLights = setup.Add([this] {
+            lightGrid.Build(
+                lights, viewMatrix, perspectiveMat, framebuffer->Width(), framebuffer->Height(), frameArena());
+        });
+        const auto gatherCasters = setup.Add([this] {
+            if (shadowCastersDirty) updateShadowCasters();
+        });
+
+        // The shadow map is cached; this only re-renders it if the light or a renderable moved (which temporal
+        // reuse can't account for, so it drops its history then).
+        bool shadows = false;
+        bool shadowsChanged = false;
+        setup.Add(
+            [this, &shadows, &shadowsChanged] {
+                const Light* sun = lightGrid.ShadowCaster();
+                shadows = shadowMode != SHADOWS_OFF && sun != nullptr;
+                if (shadows) shadowsChanged = shadowMap.Update(*sun, shadowCasters, jobs, frameArena());
+            },
+            {buildLights, gatherCasters});
+
+        // Everything is transformed up front so that the prepass and the shading pass see identical triangles. The
+        // shadow map above always uses the full meshes, so shadows don't shift as LODs change.
+        // A partial frame only needs the renderables that overlap the regions it redraws.
+        transformedFaces.resize(renderables.size());
+        for (size_t i = 0; i < renderables.size(); ++i)
+        {
+            const SampleBounds& bounds = frameState(*framebuffer).renderables[i].screenBounds;
+            const auto overlaps = [&bounds](const SampleBounds& dirty) {
+                return !dirty.Intersect(bounds).Empty();
+            };
+            if (partial && std::none_of(dirtyRegions.begin(), dirtyRegions.end(), overlaps))
+            {
+                transformedFaces[i] = {};
+                continue;
+            }
+            setup.Add([this, i] {
+                const Renderable& renderable = *renderables[i];
+                int lod = 0;
+                if (lodThreshold > 0 && !renderable.mesh->lods.empty())
+                {
+                    const auto& s = renderable.scale;
+                    const slib::mat4 modelMatrix =
+                        smath::translation({renderable.position.x, renderable.position.y, renderable.position.z}) *
+                        (smath::rotation(renderable.eulerAngles) * smath::scale({s.x, s.y, s.z}));
+                    const slib::vec4 origin = (viewMatrix * modelMatrix) * slib::vec4(0, 0, 0, 1);
+                    const float scale = std::max({std::abs(s.x), std::abs(s.y), std::abs(s.z)});
+                    lod = selectLod(*renderable.mesh, origin.x, origin.y, origin.z, scale);
+                }
+                const MeshGeometry& geometry = lodGeometry(*renderable.mesh, lod);
+                FrameArena& arena = frameArena();
+                transformedFaces[i] = arena.Allocate<slib::tri>(geometry.TriangleCount());
+                transformFaces(
+                    jobs,
+                    renderable,
+                    viewMatrix,
+                    perspectiveMat,
+                    nearW,
+                    static_cast<float>(framebuffer->Width()),
+                    static_cast<float>(framebuffer->Height()),
+                    geometry,
+                    arena.Allocate<slib::vertex>(geometry.vertices.size()),
+                    transformedFaces[i]);
+            });
+        }
+
+        visibleInstances.resize(instancedRenderables.size());
+        visibleInstanceLods.resize(instancedRenderables.size());
+        for (size_t i = 0; i < instancedRenderables.size(); ++i)
+        {
+            setup.Add([this, i] {
+                cullInstances(*instancedRenderables[i], frameArena(), visibleInstances[i], visibleInstanceLods[i]);
+            });
+        }
+        setup.Run(jobs);
+
+        // Room for the largest instanced mesh (at any LOD), which every instance is transformed through in turn
+        std::size_t instanceVertexCount = 0, instanceTriangleCount = 0;
+        for (const auto* instanced : instancedRenderables)
+        {
+            for (int lod = 0; lod <= static_cast<int>(instanced->mesh->lods.size()); ++lod)
+            {
+                const MeshGeometry& geometry = lodGeometry(*instanced->mesh, lod);
+                instanceVertexCount = std::max(instanceVertexCount, geometry.vertices.size());
+                instanceTriangleCount = std::max(instanceTriangleCount, geometry.TriangleCount());
+            }
+        }
+        instanceVertices = frameArena().Allocate<slib::vertex>(instanceVertexCount);
+        instanceFaces = frameArena().Allocate<slib::tri>(instanceTriangleCount);
 
-#pragma omp parallel for default(none) shared(faces, renderable)
-            for (const auto& f : faces)
+        // A full frame is rasterized as one region, a partial frame one dirty region at a time
+        const SampleBounds screen{0, framebuffer->Width() - 1, 0, framebuffer->Height() - 1};
+        const std::span<const SampleBounds> regions =
+            partial ? std::span<const SampleBounds>(dirtyRegions) : std::span(&screen, 1);
+        for (const auto& next : regions)
+        {
+            region = next;
+            if (prepass)
             {
-                if (f.skip) continue;
-                const auto& p1 = f.v1.screenPoint;
-                const auto& p2 = f.v2.screenPoint;
-                const auto& p3 = f.v3.screenPoint;
-
-                const float area = (p3.x - p1.x) * (p2.y - p1.y) -
-                                   (p3.y - p1.y) * (p2.x - p1.x); // area of the triangle multiplied by 2
-                if (area < 0) continue;                           // Backface culling
-                Rasterizer rasterizer(zBuffer.get(), *renderable, f, sdlSurface, fragmentShader, textureFilter);
-                rasterizer.rasterizeTriangle(area);
+                for (size_t i = 0; i < renderables.size(); ++i)
+                    rasterizeFaces(*renderables[i], transformedFaces[i], shadows, DEPTH_ONLY);
+                drawInstances(shadows, DEPTH_ONLY);
             }
+            if (temporal)
+            {
+                if (shadowsChanged) temporalCache.Invalidate();
+                temporalCache.Reproject(*framebuffer, viewMatrix, perspectiveMat, nearW, jobs);
+                reusedPixels = temporalCache.Reused();
+            }
+            for (size_t i = 0; i < renderables.size(); ++i)
+                rasterizeFaces(*renderables[i], transformedFaces[i], shadows, prepass ? SHADE_EQUAL : SHADE);
+            drawInstances(shadows, prepass ? SHADE_EQUAL : SHADE);
+            reusedPixels = nullptr;
         }
+        checkerboardParity = -1;
+        if (framebuffer->Samples() > 1) framebuffer->Resolve(jobs);
+        if (temporal)
+            temporalCache.Store(*framebuffer, viewMatrix, perspectiveMat, jobs);
+        else
+            temporalCache.Invalidate();
+        if (checkerboarded)
+            checkerboardFill.Fill(*framebuffer, viewMatrix, jobs);
+        else
+            checkerboardFill.Invalidate();
+
+        for (auto& arena : frameArenas)
+            arena.Reset();
+    }
 
-        pushBuffer(sdlRenderer, sdlSurface);
+    FrameArena& Renderer::frameArena()
+    {
+        if (std::this_thread::get_id() == frameThread) return frameArenas.back();
+        return frameArenas[jobs.ThreadIndex()];
+    }
+
+    void Renderer::finishFrame()
+    {
+        if (!frameInFlight.valid()) return;
+        frameInFlight.get();
+        std::swap(framebuffer, presented);
+        presentPending = true;
+    }
+
+    void Renderer::invalidateHistory()
+    {
+        temporalCache.Invalidate();
+        checkerboardFill.Invalidate();
+        ++generation;
     }
 
     void Renderer::AddRenderable(const Renderable* renderable)
     {
+        finishFrame();
+        invalidateHistory();
         renderables.push_back(renderable);
+        shadowCastersDirty = true;
+    }
+
+    void Renderer::AddInstancedRenderable(const InstancedRenderable* instanced)
+    {
+        finishFrame();
+        invalidateHistory();
+        instancedRenderables.push_back(instanced);
+        shadowCastersDirty = true;
     }
 
     void Renderer::ClearRenderables()
     {
+        finishFrame();
+        invalidateHistory();
         renderables.clear();
+        instancedRenderables.clear();
+        shadowCastersDirty = true;
+    }
+
+    void Renderer::AddLight(const Light* light)
+    {
+        finishFrame();
+        invalidateHistory();
+        lights.push_back(light);
+    }
+
+    void Renderer::ClearLights()
+    {
+        finishFrame();
+        invalidateHistory();
+        lights.clear();
     }
 
     void Renderer::setShader(FragmentShader shader)
     {
+        finishFrame();
+        invalidateHistory();
         //    if (shader == GOURAUD)
         //    {
         //        for (auto& renderable : renderables)
@@ -191,23 +654,122 @@ namespace sage
 
     void Renderer::setTextureFilter(TextureFilter filter)
     {
+        finishFrame();
+        invalidateHistory();
         textureFilter = filter;
     }
 
-    Renderer::~Renderer()
+    void Renderer::setShadowMode(ShadowMode mode)
+    {
+        finishFrame();
+        invalidateHistory();
+        shadowMode = mode;
+    }
+
+    void Renderer::setDepthFormat(DepthFormat format)
+    {
+        finishFrame();
+        invalidateHistory();
+        for (auto& buffer : framebuffers)
+            buffer.SetDepthFormat(format, jobs);
+    }
+
+    void Renderer::setMsaa(bool enabled)
+    {
+        finishFrame();
+        invalidateHistory();
+        for (auto& buffer : framebuffers)
+            buffer.SetSamples(enabled ? msaaSamples : 1, jobs);
+    }
+
+    bool Renderer::Msaa() const
+    {
+        return framebuffer->Samples() > 1;
+    }
+
+    void Renderer::Resize(int width, int height)
+    {
+        // A minimised window can report a zero size; keep rendering at the last real one
+        if (width <= 0 || height <= 0) return;
+        finishFrame();
+        // The projection changes with the aspect ratio even when the scaled framebuffer size rounds to the same
+        invalidateHistory();
+        outputWidth = width;
+        outputHeight = height;
+        resizeFramebuffer();
+        updateProjection();
+    }
+
+    void Renderer::setRenderScale(float scale)
+    {
+        finishFrame();
+        renderScale = std::clamp(scale, 0.25f, 1.0f);
+        resizeFramebuffer();
+    }
+
+    float Renderer::RenderScale() const
+    {
+        return renderScale;
+    }
+
+    void Renderer::setLodThreshold(float pixels)
     {
-        SDL_FreeSurface(sdlSurface);
+        finishFrame();
+        invalidateHistory();
+        lodThreshold = std::max(pixels, 0.0f);
+    }
+
+    void Renderer::resizeFramebuffer()
+    {
+        // At least one pixel, however small the output is scaled
+        const int width = std::max(static_cast<int>(std::lround(outputWidth * renderScale)), 1);
+        const int height = std::max(static_cast<int>(std::lround(outputHeight * renderScale)), 1);
+        // The dynamic resolution controller sets the scale every frame, mostly to what it already is
+        if (width == framebuffer->Width() && height == framebuffer->Height()) return;
+        invalidateHistory();
+        for (auto& buffer : framebuffers)
+            buffer.Resize(width, height, jobs);
+    }
+
+    void Renderer::updateProjection()
+    {
+        const float aspect = static_cast<float>(outputWidth) / static_cast<float>(outputHeight);
+        perspectiveMat = smath::perspective(fov * RAD, zNear, aspect, zFar);
+
+        // The near clip plane is where clip space z crosses 0. Find its distance from the z row of the projection
+        // (linear in view space z) and take w there, so that reversed depth is 1 on the near plane.
+        const float z0 = (slib::vec4(0, 0, 0, 1) * perspectiveMat).z;
+        const float z1 = (slib::vec4(0, 0, -1, 1) * perspectiveMat).z;
+        const float nearDistance = -z0 / (z1 - z0);
+        nearW = (slib::vec4(0, 0, -nearDistance, 1) * perspectiveMat).w;
+
+        // Clip space is perspectiveMat times the view space position, so each clip test (x <= w, -w <= x, y <= w,
+        // -w <= y, z >= 0 as in makeClipSpace) is a plane whose coefficients are a combination of its rows.
+        const auto& p = perspectiveMat.data;
+        // a * row(i) + b * row(3), normalised so that the plane gives distances
+        auto plane = [&p](int i, float a, float b) {
+            float c[4];
+            for (int j = 0; j < 4; ++j)
+                c[j] = a * p[i][j] + b * p[3][j];
+            const float length = std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+            return slib::vec4{c[0] / length, c[1] / length, c[2] / length, c[3] / length};
+        };
+        frustumPlanes = {plane(0, -1, 1), plane(0, 1, 1), plane(1, -1, 1), plane(1, 1, 1), plane(2, 1, 0)};
     }
 
-    Renderer::Renderer(SDL_Renderer* _sdlRenderer)
-        : zBuffer(std::make_unique<ZBuffer>()),
+    Renderer::Renderer(SDL_Renderer* _sdlRenderer, int width, int height, const ThreadConfig& threads)
+        : outputWidth(width),
+          outputHeight(height),
           sdlRenderer(_sdlRenderer),
-          perspectiveMat(smath::perspective(fov * RAD, zNear, aspect, zFar)),
+          perspectiveMat(smath::perspective(fov * RAD, zNear, static_cast<float>(width) / height, zFar)),
           viewMatrix(smath::fpsview({0, 0, 0}, 0, 0)),
-          sdlSurface(SDL_CreateRGBSurface(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, 0, 0, 0, 0)),
+          jobs(threads),
+          frameArenas(jobs.ThreadCount() + 1),
           camera(Camera({0, 0, 5}, {0, 0, 0}, {0, 0, -1}, {0, 1, 0}, zFar, zNear))
     {
-        SDL_SetSurfaceBlendMode(sdlSurface, SDL_BLENDMODE_BLEND);
+        frameThread = framePool.Submit([] { return std::this_thread::get_id(); }).get();
+        resizeFramebuffer();
+        updateProjection();
     }
 
 } // namespace sage
\ No newline at end of file
@@ -5,52 +5,183 @@
 #pragma once
 
 #include "Camera.hpp"
+#include "Checkerboard.hpp"
 #include "constants.hpp"
+#include "FrameArena.hpp"
+#include "Framebuffer.hpp"
+#include "FrameState.hpp"
+#include "InstancedRenderable.hpp"
+#include "JobSystem.hpp"
+#include "Light.hpp"
+#include "LightGrid.hpp"
+#include "LoaderPool.hpp"
 #include "Rasterizer.hpp"
+#include "ShadowMap.hpp"
 #include "slib.hpp"
+#include "TemporalCache.hpp"
 
 #include <SDL2/SDL.h>
 
+#include <array>
+#include <cstdint>
+#include <future>
 #include <memory>
+#include <span>
+#include <thread>
 #include <vector>
 
 namespace sage
 {
-    struct ZBuffer;
     struct Renderable;
     struct Mesh;
 
     class Renderer
     {
+        enum RasterPass
+        {
+            SHADE,       // Depth test and shade in one go
+            DEPTH_ONLY,  // Z-prepass
+            SHADE_EQUAL, // Shade only the fragments the Z-prepass kept
+        };
+
         static constexpr float zFar = 1000;
         static constexpr float zNear = 0.1;
-        static constexpr float aspect = SCREEN_WIDTH / SCREEN_HEIGHT;
         static constexpr float fov = 90;
-        static constexpr unsigned long screenSize = SCREEN_WIDTH * SCREEN_HEIGHT;
+        // Temporal reuse and checkerboarding take this many frames of an unchanging scene to settle on their final
+        // picture, after which rendering can stop (see Render)
+        static constexpr int settleFrames = 8;
 
-        std::unique_ptr<ZBuffer> zBuffer;
+        // Internal resolution is the output (window) size times renderScale, stretched to the output on present.
+        // Double buffered: a frame renders into framebuffer on framePool while the one before it, in presented,
+        // goes to the screen.
+        Framebuffer framebuffers[2];
+        Framebuffer* framebuffer = &framebuffers[0];
+        Framebuffer* presented = &framebuffers[1];
+        std::future<void> frameInFlight;
+        bool presentPending = true; // presented hasn't been uploaded to its texture yet
+        // What each framebuffer (by index) was last rendered from, and the next frame's, to compare with them
+        FrameState frameStates[2];
+        FrameState nextFrameState;
+        std::uint64_t generation = 1; // Bumped by anything that changes frames other than through FrameState
+        // The parts of framebuffer a partial frame redraws, and the part being rasterized (all of it otherwise)
+        std::vector<SampleBounds> dirtyRegions;
+        SampleBounds region{};
+        int stillFrames = 0; // Renders in a row that found nothing changed (up to settleFrames)
+        bool idle = false;
+        int outputWidth;
+        int outputHeight;
+        float renderScale = 1;
         void updateViewMatrix();
-        void clearBuffer() const;
+        void renderFrame(bool prepass, bool temporal, bool checkerboarded, bool partial);
+        // Waits for the frame in flight (if any) and swaps it in to be presented. Everything that changes what a
+        // frame reads calls this first.
+        void finishFrame();
+        // Drops the frames kept for temporal reuse and checkerboarding, and marks both framebuffers out of date.
+        // For changes other than the camera's and the renderables' (which FrameState tracks).
+        void invalidateHistory();
+        FrameState& frameState(const Framebuffer& buffer);
+        void captureFrameState(FrameState& state) const;
+        SampleBounds screenBounds(const Renderable& renderable) const;
+        void updateProjection();
+        void resizeFramebuffer();
+        void rasterizeFace(const Renderable& renderable, const slib::tri& f, bool shadows, RasterPass pass);
+        void rasterizeFaces(
+            const Renderable& renderable, std::span<const slib::tri> faces, bool shadows, RasterPass pass);
+        void cullInstances(
+            const InstancedRenderable& instanced,
+            FrameArena& arena,
+            std::span<std::uint32_t>& visible,
+            std::span<std::uint8_t>& lods);
+        int selectLod(const Mesh& mesh, float viewX, float viewY, float viewZ, float scale) const;
+        void drawInstances(bool shadows, RasterPass pass);
+        void updateShadowCasters();
         SDL_Renderer* sdlRenderer;
         slib::mat4 perspectiveMat;
+        float nearW = 1; // Clip space w on the near plane
         slib::mat4 viewMatrix;
-        SDL_Surface* sdlSurface;
         std::vector<const Renderable*> renderables;
+        std::vector<const Light*> lights;
+        LightGrid lightGrid;
+        ShadowMap shadowMap;
         FragmentShader fragmentShader = FLAT;
         TextureFilter textureFilter = NEIGHBOUR;
+        ShadowMode shadowMode = SHADOWS_HARD;
+        // The last frame's shading, and which of this frame's pixels reuse it (nullptr outside the shading pass)
+        TemporalCache temporalCache;
+        const std::uint8_t* reusedPixels = nullptr;
+        // Fills in the pixels a checkerboarded frame skips; checkerboardParity is the frame's (-1 when off)
+        Checkerboard checkerboardFill;
+        int checkerboardParity = -1;
+        float lodThreshold = 0; // Largest allowed projected LOD error in pixels; 0 always draws the full mesh
+        // Screen space faces of each renderable for the current frame, in the frame arenas
+        std::vector<std::span<slib::tri>> transformedFaces;
+
+        std::vector<const InstancedRenderable*> instancedRenderables;
+        // View space frustum planes (inside where dot(plane, {x, y, z, 1}) >= 0), for culling instance bounds
+        std::array<slib::vec4, 5> frustumPlanes{};
+        std::vector<std::span<std::uint32_t>> visibleInstances; // Per instanced renderable, this frame
+        std::vector<std::span<std::uint8_t>> visibleInstanceLods; // LOD of each visible instance (see selectLod)
+        // Instances are transformed and drawn one at a time through here, so memory doesn't grow with their number
+        std::span<slib::vertex> instanceVertices;
+        std::span<slib::tri> instanceFaces;
+        // What the shadow map sees: every renderable plus a renderable per instance
+        std::vector<Renderable> instanceCasters;
+        std::vector<const Renderable*> shadowCasters;
+        bool shadowCastersDirty = true;
+        JobSystem jobs; // Runs the stages of a frame
+        // For data that only lives for the frame: one per job system thread, then one for the frame thread. All
+        // are reset when the frame finishes.
+        std::vector<FrameArena> frameArenas;
+        std::thread::id frameThread; // framePool's thread
+        // The calling thread's arena. The frame thread has its own, so it never shares one with a thread outside
+        // the job system that is doing something else meanwhile (such as presenting the frame before).
+        FrameArena& frameArena();
+        LoaderPool framePool{1}; // Last, so a frame in flight finishes before anything it uses is destroyed
 
       public:
         bool wireFrame = false;
+        // Resolve visibility with a depth-only pass first, so each pixel is shaded once
+        bool zPrepass = false;
+        // Reuse the last frame's shading where the camera's movement can be reprojected (see TemporalCache).
+        // Assumes nothing but the camera moves between settings changes; implies zPrepass; ignored with MSAA.
+        bool temporalReuse = false;
+        // Rasterize half the pixels each frame, alternating, and fill in the rest (see Checkerboard). Ignored with
+        // MSAA or temporal reuse.
+        bool checkerboard = false;
         Camera camera;
-        explicit Renderer(SDL_Renderer* _sdlRenderer);
-
-        ~Renderer();
+        Renderer(SDL_Renderer* _sdlRenderer, int width, int height, const ThreadConfig& threads = {});
 
-        void RenderBuffer() const;
+        // Starts rendering a frame in the background and draws the previous one. The picture on screen is one
+        // frame behind, in exchange for overlapping rendering with the GUI and SDL_RenderPresent.
+        //
+        // Only what changed is rendered: if neither the camera, the renderables, the lights nor any setting did,
+        // the last frame is drawn again as it is, and if only some renderables moved (with no shadow map in use),
+        // just the screen tiles they covered before and cover now are redrawn.
         void Render();
+        // True when the last Render had nothing new to draw, so the caller can wait for input before the next
+        bool Idle() const;
+        // Presents, then waits for the frame started by Render, so the scene can be changed safely afterwards.
+        void RenderBuffer();
         void AddRenderable(const Renderable* renderable);
+        void AddInstancedRenderable(const InstancedRenderable* instanced);
+        // Removes both plain and instanced renderables
         void ClearRenderables();
+        void AddLight(const Light* light);
+        void ClearLights();
         void setShader(FragmentShader shader);
         void setTextureFilter(TextureFilter filter);
+        void setShadowMode(ShadowMode mode);
+        void setDepthFormat(DepthFormat format);
+        // 4x multisample anti-aliasing: coverage and depth per sample, shading per pixel
+        void setMsaa(bool enabled);
+        bool Msaa() const;
+        // Sets the output (window) size in pixels. Zero sizes (a minimised window) are ignored.
+        void Resize(int width, int height);
+        // Fraction of the output resolution to render at, clamped to [0.25, 1].
+        void setRenderScale(float scale);
+        float RenderScale() const;
+        // Picks each renderable's (and instance's) coarsest LOD whose simplification error stays under this many
+        // pixels on screen. 0 disables LODs.
+        void setLodThreshold(float pixels);
     };
 } // namespace sage
@@ -0,0 +1,24 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "ResourceCache.hpp"
+
+#include "MeshCache.hpp"
+
+namespace sage::ResourceCache
+{
+    static ResourceTable<Mesh> meshes;
+    static ResourceTable<slib::texture> textures;
+
+    std::shared_ptr<const Mesh> GetMesh(const std::string& objPath)
+    {
+        return meshes.Get(objPath, [&objPath] { return MeshCache::Load(objPath.c_str()); });
+    }
+
+    std::shared_ptr<const slib::texture> GetTexture(
+        const std::string& path, const std::function<slib::texture()>& load)
+    {
+        return textures.Get(path, load);
+    }
+} // namespace sage::ResourceCache
@@ -0,0 +1,68 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "Mesh.hpp"
+#include "slib.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace sage
+{
+    // Loaded resources of one type keyed by path. Everyone asking for the same path shares one immutable copy,
+    // and an entry is evicted (freed) as soon as the last handle to it is released.
+    template <typename T>
+    class ResourceTable
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::weak_ptr<const T>> entries;
+
+        void evictUnreferenced()
+        {
+            for (auto it = entries.begin(); it != entries.end();)
+                it = it->second.expired() ? entries.erase(it) : std::next(it);
+        }
+
+      public:
+        // load() runs without the lock held, so other resources can load concurrently. If two threads miss on
+        // the same path at once, both load it and the first one stored wins.
+        template <typename Load>
+        std::shared_ptr<const T> Get(const std::string& key, Load&& load)
+        {
+            {
+                std::lock_guard lock(mutex);
+                if (auto it = entries.find(key); it != entries.end())
+                    if (auto resource = it->second.lock()) return resource;
+            }
+            auto loaded = std::make_shared<const T>(load());
+            std::lock_guard lock(mutex);
+            evictUnreferenced();
+            auto& entry = entries[key];
+            if (auto resource = entry.lock()) return resource;
+            entry = loaded;
+            return loaded;
+        }
+
+        std::size_t Size()
+        {
+            std::lock_guard lock(mutex);
+            evictUnreferenced();
+            return entries.size();
+        }
+    };
+
+    namespace ResourceCache
+    {
+        // Loads an obj model (through MeshCache) or returns the copy that is already loaded
+        std::shared_ptr<const Mesh> GetMesh(const std::string& objPath);
+        std::shared_ptr<const slib::texture> GetTexture(
+            const std::string& path, const std::function<slib::texture()>& load);
+    } // namespace ResourceCache
+} // namespace sage
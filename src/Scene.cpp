@@ -13,10 +13,20 @@ void Scene::LoadScene()
     renderer.camera.rotation = data->cameraStartRotation;
     renderer.setShader(data->fragmentShader);
     renderer.setTextureFilter(data->textureFilter);
+    renderer.setShadowMode(data->shadowMode);
     renderer.ClearRenderables();
     for (const auto& renderable : data->renderables)
     {
         renderer.AddRenderable(renderable.get());
     }
+    for (const auto& instanced : data->instancedRenderables)
+    {
+        renderer.AddInstancedRenderable(instanced.get());
+    }
+    renderer.ClearLights();
+    for (const auto& light : data->lights)
+    {
+        renderer.AddLight(&light);
+    }
 }
 }
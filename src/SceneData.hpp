@@ -3,6 +3,8 @@
 //
 #pragma once
 
+#include "InstancedRenderable.hpp"
+#include "Light.hpp"
 #include "Renderable.hpp"
 #include "slib.hpp"
 #include <vector>
@@ -13,8 +15,11 @@ namespace sage
     {
         FragmentShader fragmentShader = FLAT;
         TextureFilter textureFilter = NEIGHBOUR;
+        ShadowMode shadowMode = SHADOWS_HARD;
         slib::vec3 cameraStartPosition{};
         slib::vec3 cameraStartRotation{};
         std::vector<std::unique_ptr<Renderable>> renderables;
+        std::vector<std::unique_ptr<InstancedRenderable>> instancedRenderables;
+        std::vector<Light> lights{Light::Directional({1, 1, 1.5})};
     };
 } // namespace sage
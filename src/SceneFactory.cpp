@@ -4,19 +4,19 @@
 
 #include "SceneFactory.hpp"
 
-#include "ObjParser.hpp"
 #include "Renderer.hpp"
+#include "ResourceCache.hpp"
 #include "Scene.hpp"
 
 namespace sage
 {
     std::unique_ptr<Scene> spyroSceneInit(Renderer* renderer)
     {
-        Mesh mesh = ObjParser::ParseObj("resources/spyrolevel.obj");
-        mesh.atlas = true;
-        mesh.atlasTileSize = 32;
+        auto mesh = ResourceCache::GetMesh("resources/spyrolevel.obj");
         auto renderable = std::make_unique<Renderable>(
             Renderable(mesh, {0, 0, -25}, {0, 250, 0}, {.05, .05, .05}, {200, 100, 200}));
+        renderable->atlas = true;
+        renderable->atlasTileSize = 32;
         auto sceneData = std::make_unique<SceneData>();
         sceneData->renderables.push_back(std::move(renderable));
         sceneData->cameraStartPosition = {50, 20, 150};
@@ -28,11 +28,20 @@ namespace sage
 
     std::unique_ptr<Scene> isometricGameLevel(Renderer* renderer)
     {
-        Mesh mesh = ObjParser::ParseObj("resources/Isometric_Game_Level_Low_Poly.obj");
+        auto mesh = ResourceCache::GetMesh("resources/Isometric_Game_Level_Low_Poly.obj");
         auto renderable =
             std::make_unique<Renderable>(Renderable(mesh, {0, 0, -25}, {0, 250, 0}, {5, 5, 5}, {200, 100, 200}));
         auto sceneData = std::make_unique<SceneData>();
         sceneData->renderables.push_back(std::move(renderable));
+        // A grid of coloured lamps scattered over the level
+        const slib::vec3 lampColors[] = {{1, 0.4, 0.2}, {0.3, 0.6, 1}, {1, 0.3, 0.8}, {1, 0.9, 0.5}};
+        for (int i = 0; i < 24; ++i)
+        {
+            const slib::vec3 lampPos = {-90.0f + (i % 6) * 50.0f, 15, -90.0f + (i / 6) * 60.0f};
+            sceneData->lights.push_back(Light::Point(lampPos, lampColors[i % 4], 1, 40));
+        }
+        // Many of this model's normals face the opposite way to its winding, which the shadow map can't agree with
+        sceneData->shadowMode = SHADOWS_OFF;
         sceneData->cameraStartPosition = {150, 150, 200};
         sceneData->cameraStartRotation = {-28, 32, 0};
         sceneData->fragmentShader = GOURAUD;
@@ -42,7 +51,7 @@ namespace sage
 
     std::unique_ptr<Scene> concreteCatInit(Renderer* renderer)
     {
-        Mesh mesh = ObjParser::ParseObj("resources/concrete_cat_statue.obj");
+        auto mesh = ResourceCache::GetMesh("resources/concrete_cat_statue.obj");
         auto renderable =
             std::make_unique<Renderable>(Renderable(mesh, {0, -2, -1}, {0, 0, 0}, {10, 10, 10}, {200, 100, 200}));
         auto sceneData = std::make_unique<SceneData>();
@@ -56,16 +65,42 @@ namespace sage
 
     std::unique_ptr<Scene> vikingRoomSceneInit(Renderer* renderer)
     {
-        Mesh mesh = ObjParser::ParseObj("resources/viking_room.obj");
+        auto mesh = ResourceCache::GetMesh("resources/viking_room.obj");
         auto renderable = std::make_unique<Renderable>(
             Renderable(mesh, {0.75, -2, -1}, {0, -135, 0}, {7.5, 7.5, 7.5}, {200, 100, 200}));
         auto sceneData = std::make_unique<SceneData>();
 
         sceneData->renderables.push_back(std::move(renderable));
+        // Hearth and wall torches
+        sceneData->lights.push_back(Light::Point({0, 1, 1}, {1, 0.5, 0.2}, 1.5, 5));
+        sceneData->lights.push_back(Light::Point({-4, 4, 3}, {1, 0.6, 0.3}, 1, 4));
+        sceneData->lights.push_back(Light::Point({4, 4, 3}, {1, 0.6, 0.3}, 1, 4));
         sceneData->cameraStartPosition = {0, 0, 38};
         sceneData->cameraStartRotation = {-23, 0, 0};
         sceneData->fragmentShader = GOURAUD;
         sceneData->textureFilter = NEIGHBOUR;
         return std::make_unique<Scene>(*renderer, std::move(sceneData));
     }
+
+    std::unique_ptr<Scene> instancedVillageInit(Renderer* renderer)
+    {
+        // A field of viking rooms: one mesh in memory however many copies are drawn
+        auto village = std::make_unique<InstancedRenderable>(
+            ResourceCache::GetMesh("resources/viking_room.obj"), slib::Color{200, 100, 200});
+        constexpr int rows = 12;
+        for (int z = 0; z < rows; ++z)
+        {
+            for (int x = 0; x < rows; ++x)
+            {
+                village->Add({(x - rows / 2) * 3.0f, -1, (z - rows / 2) * 3.0f}, {0, -135, 0}, {1, 1, 1});
+            }
+        }
+        auto sceneData = std::make_unique<SceneData>();
+        sceneData->instancedRenderables.push_back(std::move(village));
+        sceneData->cameraStartPosition = {0, 4, 16};
+        sceneData->cameraStartRotation = {-12, 0, 0};
+        sceneData->fragmentShader = GOURAUD;
+        sceneData->textureFilter = NEIGHBOUR;
+        return std::make_unique<Scene>(*renderer, std::move(sceneData));
+    }
 } // namespace sage
@@ -11,8 +11,12 @@ namespace sage
     class Scene;
     class Renderer;
 
+    // Builds a scene. These only touch the renderer through the Scene they return, so may run on any thread.
+    using SceneInit = std::unique_ptr<Scene> (*)(Renderer* renderer);
+
     std::unique_ptr<Scene> spyroSceneInit(Renderer* renderer);
     std::unique_ptr<Scene> isometricGameLevel(Renderer* renderer);
     std::unique_ptr<Scene> concreteCatInit(Renderer* renderer);
     std::unique_ptr<Scene> vikingRoomSceneInit(Renderer* renderer);
+    std::unique_ptr<Scene> instancedVillageInit(Renderer* renderer);
 } // namespace sage
\ No newline at end of file
@@ -0,0 +1,158 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "ShadowMap.hpp"
+
+#include "DepthRasterizer.hpp"
+#include "Renderable.hpp"
+#include "smath.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace sage
+{
+    void ShadowMap::render(const std::vector<const Renderable*>& renderables, JobSystem& jobs, FrameArena& arena)
+    {
+        axisD = smath::normalize(lightDirection);
+        const slib::vec3 up = std::abs(axisD.y) > 0.99f ? slib::vec3{1, 0, 0} : slib::vec3{0, 1, 0};
+        axisU = smath::normalize(smath::cross(up, axisD));
+        axisV = smath::cross(axisD, axisU);
+
+        // Light space position of every caster vertex
+        std::size_t pointCount = 0, triangleCount = 0;
+        for (const auto* renderable : renderables)
+        {
+            pointCount += renderable->mesh->geometry.vertices.size();
+            triangleCount += renderable->mesh->geometry.TriangleCount();
+        }
+        const auto points = arena.Allocate<slib::vec3>(pointCount);
+        std::size_t offset = 0;
+        for (const auto* renderable : renderables)
+        {
+            const slib::mat4 scaleMatrix =
+                smath::scale({renderable->scale.x, renderable->scale.y, renderable->scale.z});
+            const slib::mat4 rotationMatrix = smath::rotation(renderable->eulerAngles);
+            const slib::mat4 translationMatrix =
+                smath::translation({renderable->position.x, renderable->position.y, renderable->position.z});
+            const slib::mat4 fullTransformMat = translationMatrix * (rotationMatrix * scaleMatrix);
+
+            const Mesh& mesh = *renderable->mesh;
+            const auto& vertices = mesh.geometry.vertices;
+            auto toLightSpace = [this, &fullTransformMat](const slib::vec3& position) {
+                slib::vec3 world{};
+                world = fullTransformMat * slib::vec4(position, 1);
+                return slib::vec3{smath::dot(world, axisU), smath::dot(world, axisV), -smath::dot(world, axisD)};
+            };
+            jobs.ParallelFor(vertices.size(), 1024, [&](std::size_t begin, std::size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                    points[offset + i] = toLightSpace(mesh.quantization.DecodePosition(vertices[i]));
+            });
+            offset += vertices.size();
+        }
+
+        // Fit an orthographic projection around the casters
+        float maxU = -FLT_MAX, maxV = -FLT_MAX;
+        minU = minV = FLT_MAX;
+        for (const auto& p : points)
+        {
+            minU = std::min(minU, p.x);
+            maxU = std::max(maxU, p.x);
+            minV = std::min(minV, p.y);
+            maxV = std::max(maxV, p.y);
+        }
+        texelsPerUnitU = (size - 1) / std::max(maxU - minU, 0.001f);
+        texelsPerUnitV = (size - 1) / std::max(maxV - minV, 0.001f);
+        texelSize = std::max(1 / texelsPerUnitU, 1 / texelsPerUnitV);
+
+        const auto allTriangles = arena.Allocate<DepthTriangle>(triangleCount);
+        std::size_t setUp = 0;
+        offset = 0;
+        auto toMap = [this](const slib::vec3& p) {
+            return slib::vec3{(p.x - minU) * texelsPerUnitU, (p.y - minV) * texelsPerUnitV, p.z};
+        };
+        for (const auto* renderable : renderables)
+        {
+            const auto& geometry = renderable->mesh->geometry;
+            for (size_t i = 0; i < geometry.indices.size(); i += 3)
+            {
+                const slib::vec3& p1 = points[offset + geometry.indices[i]];
+                const slib::vec3& p2 = points[offset + geometry.indices[i + 1]];
+                const slib::vec3& p3 = points[offset + geometry.indices[i + 2]];
+                DepthTriangle triangle{};
+                // Both sides of a caster block the light, so back faces are kept.
+                if (triangle.Setup(toMap(p1), toMap(p2), toMap(p3), size, size, false))
+                    allTriangles[setUp++] = triangle;
+            }
+            offset += geometry.vertices.size();
+        }
+        const auto triangles = allTriangles.first(setUp);
+
+        // Each job owns a band of rows, so depth writes never race.
+        depth.assign(size * size, FLT_MAX);
+        constexpr int bandHeight = 32;
+        jobs.ParallelFor(size / bandHeight, 1, [&](std::size_t begin, std::size_t end) {
+            auto closest = [](float z, float& stored) {
+                if (z < stored) stored = z;
+            };
+            for (auto band = static_cast<int>(begin); band < static_cast<int>(end); ++band)
+            {
+                for (const auto& triangle : triangles)
+                {
+                    rasterizeDepth(
+                        triangle, depth.data(), size, band * bandHeight, (band + 1) * bandHeight, closest);
+                }
+            }
+        });
+    }
+
+    bool ShadowMap::Update(
+        const Light& light, const std::vector<const Renderable*>& renderables, JobSystem& jobs, FrameArena& arena)
+    {
+        bool dirty = !valid || !(light.direction == lightDirection) || casters.size() != renderables.size();
+        for (size_t i = 0; !dirty && i < renderables.size(); ++i)
+        {
+            const auto& caster = casters[i];
+            const auto* renderable = renderables[i];
+            dirty = caster.renderable != renderable || !(caster.position == renderable->position) ||
+                    !(caster.eulerAngles == renderable->eulerAngles) || !(caster.scale == renderable->scale);
+        }
+        if (!dirty) return false;
+
+        lightDirection = light.direction;
+        casters.clear();
+        for (const auto* renderable : renderables)
+        {
+            casters.push_back({renderable, renderable->position, renderable->eulerAngles, renderable->scale});
+        }
+        render(renderables, jobs, arena);
+        valid = true;
+        return true;
+    }
+
+    float ShadowMap::Visibility(const slib::vec3& pos, const slib::vec3& normal, bool pcf) const
+    {
+        // Offset the lookup along the normal and bias the depth by a few texels to avoid self-shadowing ("acne")
+        const slib::vec3 p = pos + normal * texelSize;
+        const float x = (smath::dot(p, axisU) - minU) * texelsPerUnitU;
+        const float y = (smath::dot(p, axisV) - minV) * texelsPerUnitV;
+        const float d = -smath::dot(p, axisD) - texelSize * 4;
+        if (x < 0 || y < 0 || x >= size || y >= size) return 1;
+
+        const int tx = static_cast<int>(x);
+        const int ty = static_cast<int>(y);
+        if (!pcf) return d <= depth[ty * size + tx] ? 1.0f : 0.0f;
+
+        int lit = 0;
+        for (int sy = std::max(ty - 1, 0); sy <= std::min(ty + 1, size - 1); ++sy)
+        {
+            for (int sx = std::max(tx - 1, 0); sx <= std::min(tx + 1, size - 1); ++sx)
+            {
+                lit += d <= depth[sy * size + sx];
+            }
+        }
+        return static_cast<float>(lit) / 9.0f;
+    }
+} // namespace sage
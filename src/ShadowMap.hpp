@@ -0,0 +1,56 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "FrameArena.hpp"
+#include "JobSystem.hpp"
+#include "Light.hpp"
+#include "slib.hpp"
+
+#include <vector>
+
+namespace sage
+{
+    struct Renderable;
+
+    // Depth map of the scene as seen from a directional light, rendered with the depth-only rasterizer.
+    // The map is cached and only re-rendered when the light or a shadow caster moves.
+    class ShadowMap
+    {
+        static constexpr int size = 2048;
+
+        struct CasterState
+        {
+            const Renderable* renderable;
+            slib::vec3 position;
+            slib::vec3 eulerAngles;
+            slib::vec3 scale;
+        };
+
+        std::vector<float> depth;
+        // Light space basis. Depth is the distance along -axisD (smaller is closer to the light).
+        slib::vec3 axisU{}, axisV{}, axisD{};
+        float minU = 0, minV = 0;
+        float texelsPerUnitU = 1, texelsPerUnitV = 1;
+        float texelSize = 1; // World space size of one (the larger) texel side
+
+        slib::vec3 lightDirection{};
+        std::vector<CasterState> casters;
+        bool valid = false;
+
+        void render(const std::vector<const Renderable*>& renderables, JobSystem& jobs, FrameArena& arena);
+
+      public:
+        // Re-renders the map if the light or any caster changed since the last call. Returns true if it did.
+        // Scratch space comes from arena.
+        bool Update(
+            const Light& light,
+            const std::vector<const Renderable*>& renderables,
+            JobSystem& jobs,
+            FrameArena& arena);
+        // 1 if the world-space point is lit, 0 if it's in shadow. PCF averages a 3x3 neighbourhood of texels.
+        float Visibility(const slib::vec3& pos, const slib::vec3& normal, bool pcf) const;
+    };
+} // namespace sage
@@ -0,0 +1,258 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "TemporalCache.hpp"
+#include "smath.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace sage
+{
+    namespace
+    {
+        // Plain row-major matrices acting on column vectors, for composing the reprojection without the
+        // conventions of slib::mat4's operators
+        using Matrix = std::array<std::array<double, 4>, 4>;
+
+        Matrix multiply(const Matrix& a, const Matrix& b)
+        {
+            Matrix result{};
+            for (int i = 0; i < 4; ++i)
+            {
+                for (int j = 0; j < 4; ++j)
+                {
+                    for (int k = 0; k < 4; ++k)
+                        result[i][j] += a[i][k] * b[k][j];
+                }
+            }
+            return result;
+        }
+
+        // Gauss-Jordan elimination with partial pivoting. Returns false if m is singular.
+        bool invert(Matrix m, Matrix& inverse)
+        {
+            inverse = {};
+            for (int i = 0; i < 4; ++i)
+                inverse[i][i] = 1;
+            for (int column = 0; column < 4; ++column)
+            {
+                int pivot = column;
+                for (int row = column + 1; row < 4; ++row)
+                {
+                    if (std::abs(m[row][column]) > std::abs(m[pivot][column])) pivot = row;
+                }
+                if (m[pivot][column] == 0) return false;
+                std::swap(m[pivot], m[column]);
+                std::swap(inverse[pivot], inverse[column]);
+                const double scale = 1 / m[column][column];
+                for (int j = 0; j < 4; ++j)
+                {
+                    m[column][j] *= scale;
+                    inverse[column][j] *= scale;
+                }
+                for (int row = 0; row < 4; ++row)
+                {
+                    if (row == column) continue;
+                    const double factor = m[row][column];
+                    for (int j = 0; j < 4; ++j)
+                    {
+                        m[row][j] -= factor * m[column][j];
+                        inverse[row][j] -= factor * inverse[column][j];
+                    }
+                }
+            }
+            return true;
+        }
+
+        // World to view space, as the renderer applies the view matrix (its transpose, see
+        // Renderer::cullInstances)
+        Matrix viewTransform(const slib::mat4& viewMatrix)
+        {
+            Matrix result{};
+            for (int i = 0; i < 4; ++i)
+            {
+                for (int j = 0; j < 4; ++j)
+                    result[i][j] = viewMatrix.data[j][i];
+            }
+            return result;
+        }
+
+        // View to clip space
+        Matrix projectionTransform(const slib::mat4& perspectiveMat)
+        {
+            Matrix result{};
+            for (int i = 0; i < 4; ++i)
+            {
+                for (int j = 0; j < 4; ++j)
+                    result[i][j] = perspectiveMat.data[i][j];
+            }
+            return result;
+        }
+
+        // 4x4 ordered dither, so that each frame's refreshed pixels are spread evenly over the screen
+        constexpr std::uint8_t bayer[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+    } // namespace
+
+    TemporalCache::TemporalCache() : view(smath::identity()), projection(smath::identity())
+    {
+    }
+
+    void TemporalCache::Reproject(
+        Framebuffer& framebuffer,
+        const slib::mat4& viewMatrix,
+        const slib::mat4& perspectiveMat,
+        float nearW,
+        JobSystem& jobs)
+    {
+        const int w = framebuffer.Width();
+        const int h = framebuffer.Height();
+        const auto pixelCount = static_cast<std::size_t>(w) * h;
+        if (reused.size() != pixelCount) reused.resize(pixelCount, false);
+        // (Store swaps it with the history's, so the two are sized separately)
+        if (currentDrift.size() != pixelCount) currentDrift.resize(pixelCount, false);
+        ++frame;
+
+        // A pixel gives its clip space x, y and w (from its position and depth) but not z, so the current
+        // projection is inverted through those three rows. That takes (x, y, w, 1) to view space, then the
+        // inverse current view to the world, and the history's view and projection into its clip space.
+        const Matrix projectionNow = projectionTransform(perspectiveMat);
+        Matrix pixelToClip = projectionNow;
+        pixelToClip[2] = projectionNow[3];
+        pixelToClip[3] = {0, 0, 0, 1};
+        Matrix clipToView, viewToWorld;
+        if (!valid || width != w || height != h || !invert(pixelToClip, clipToView) ||
+            !invert(viewTransform(viewMatrix), viewToWorld))
+        {
+            std::fill(reused.data(), reused.data() + pixelCount, 0);
+            std::fill(currentDrift.data(), currentDrift.data() + pixelCount, slib::vec2{0, 0});
+            return;
+        }
+        const Matrix reprojection = multiply(
+            multiply(projectionTransform(projection), viewTransform(view)), multiply(viewToWorld, clipToView));
+
+        std::array<std::array<float, 4>, 4> single{};
+        for (int i = 0; i < 4; ++i)
+        {
+            for (int j = 0; j < 4; ++j)
+                single[i][j] = static_cast<float>(reprojection[i][j]);
+        }
+        switch (framebuffer.Depth()->Format())
+        {
+        case DEPTH_32F:
+            reproject<DEPTH_32F>(framebuffer, single, nearW, jobs);
+            break;
+        case DEPTH_24:
+            reproject<DEPTH_24>(framebuffer, single, nearW, jobs);
+            break;
+        case DEPTH_16:
+            reproject<DEPTH_16>(framebuffer, single, nearW, jobs);
+            break;
+        }
+    }
+
+    template <DepthFormat format>
+    void TemporalCache::reproject(
+        Framebuffer& framebuffer, const std::array<std::array<float, 4>, 4>& m, float nearW, JobSystem& jobs)
+    {
+        const auto* current = framebuffer.Depth()->Data<format>();
+        auto* pixels = framebuffer.Color();
+        const float halfWidth = static_cast<float>(width) / 2;
+        const float halfHeight = static_cast<float>(height) / 2;
+        const unsigned int refresh = frame % refreshPeriod;
+
+        jobs.ParallelFor(static_cast<std::size_t>(height), 8, [&](std::size_t begin, std::size_t end) {
+            for (auto y = static_cast<int>(begin); y < static_cast<int>(end); ++y)
+            {
+                const auto row = static_cast<std::size_t>(y) * width;
+                for (int x = 0; x < width; ++x)
+                {
+                    reused[row + x] = 0;
+                    currentDrift[row + x] = {0, 0};
+                    const float z = DepthEncoding<format>::Decode(current[row + x]);
+                    // Nothing drawn here, or due a refresh
+                    if (z <= 0 || bayer[y & 3][x & 3] % refreshPeriod == refresh) continue;
+
+                    // Back through createScreenSpace: reversed depth is nearW / w
+                    const float clipW = nearW / z;
+                    const float clipX = (static_cast<float>(x) - halfWidth) / halfWidth * clipW;
+                    const float clipY = (halfHeight - static_cast<float>(y)) / halfHeight * clipW;
+                    const float lastX = m[0][0] * clipX + m[0][1] * clipY + m[0][2] * clipW + m[0][3];
+                    const float lastY = m[1][0] * clipX + m[1][1] * clipY + m[1][2] * clipW + m[1][3];
+                    const float lastW = m[3][0] * clipX + m[3][1] * clipY + m[3][2] * clipW + m[3][3];
+                    if (lastW < nearW) continue; // Was behind the near plane
+
+                    const float lastScreenX = halfWidth + lastX / lastW * halfWidth;
+                    const float lastScreenY = halfHeight - lastY / lastW * halfHeight;
+                    const auto nearestX = std::lround(lastScreenX);
+                    const auto nearestY = std::lround(lastScreenY);
+                    if (nearestX < 0 || nearestX >= width || nearestY < 0 || nearestY >= height) continue;
+                    const auto last = static_cast<std::size_t>(nearestY) * width + nearestX;
+                    // Disoccluded if the history saw something else there
+                    const float expected = nearW / lastW;
+                    if (std::abs(depth[last] - expected) > depthTolerance * expected) continue;
+
+                    // The history pixel's colour was shaded at its centre plus its drift
+                    const slib::vec2 offset{
+                        static_cast<float>(nearestX) + drift[last].x - lastScreenX,
+                        static_cast<float>(nearestY) + drift[last].y - lastScreenY};
+                    if (std::abs(offset.x) > maxDrift || std::abs(offset.y) > maxDrift) continue;
+
+                    pixels[row + x] = color[last];
+                    reused[row + x] = 1;
+                    currentDrift[row + x] = offset;
+                }
+            }
+        });
+    }
+
+    void TemporalCache::Store(
+        Framebuffer& framebuffer, const slib::mat4& viewMatrix, const slib::mat4& perspectiveMat, JobSystem& jobs)
+    {
+        width = framebuffer.Width();
+        height = framebuffer.Height();
+        const auto pixelCount = static_cast<std::size_t>(width) * height;
+        if (color.size() != pixelCount)
+        {
+            color.resize(pixelCount, false);
+            depth.resize(pixelCount, false);
+        }
+        const auto* pixels = framebuffer.Color();
+        ZBuffer& zBuffer = *framebuffer.Depth();
+
+        jobs.ParallelFor(static_cast<std::size_t>(height), 8, [&](std::size_t begin, std::size_t end) {
+            const auto first = begin * width;
+            const auto count = (end - begin) * width;
+            std::memcpy(color.data() + first, pixels + first, count * sizeof(std::uint32_t));
+            auto decode = [&](auto* stored, auto decodeOne) {
+                for (std::size_t i = first; i < first + count; ++i)
+                    depth[i] = decodeOne(stored[i]);
+            };
+            switch (zBuffer.Format())
+            {
+            case DEPTH_32F:
+                decode(zBuffer.Data<DEPTH_32F>(), DepthEncoding<DEPTH_32F>::Decode);
+                break;
+            case DEPTH_24:
+                decode(zBuffer.Data<DEPTH_24>(), DepthEncoding<DEPTH_24>::Decode);
+                break;
+            case DEPTH_16:
+                decode(zBuffer.Data<DEPTH_16>(), DepthEncoding<DEPTH_16>::Decode);
+                break;
+            }
+        });
+        std::swap(drift, currentDrift);
+        view = viewMatrix;
+        projection = perspectiveMat;
+        valid = true;
+    }
+
+    void TemporalCache::Invalidate()
+    {
+        valid = false;
+    }
+} // namespace sage
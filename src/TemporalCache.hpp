@@ -0,0 +1,83 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include "AlignedBuffer.hpp"
+#include "Framebuffer.hpp"
+#include "JobSystem.hpp"
+#include "slib.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace sage
+{
+    // Reuses the last frame's shading. Each frame the final depth of every pixel (from the Z-prepass) is taken
+    // back to the world and into the last frame's screen; where the last frame saw the same surface there, its
+    // colour is copied across and the pixel is marked so the shading pass skips it. Pixels that were hidden or
+    // off screen last frame, and a rotating subset of the rest (so that nothing is reused for long), are shaded
+    // as usual.
+    //
+    // Only the camera is accounted for: anything else that changes the picture has to Invalidate the history.
+    // Single sampled framebuffers only.
+    class TemporalCache
+    {
+        // Each frame reshades the pixels at one of refreshPeriod positions of a 4x4 ordered dither pattern, so
+        // every pixel on screen is reshaded at least once in that many frames.
+        static constexpr unsigned int refreshPeriod = 8;
+        // How far (relative) the depth found in the history may be from the reprojected depth for the pixel to
+        // count as the same surface
+        static constexpr float depthTolerance = 0.02f;
+        // Colours are fetched from the nearest history pixel, so each reuse moves a colour by up to half a pixel
+        // from where it was shaded. The offsets are tracked, and a pixel is reshaded before its colour strays
+        // further than this (in pixels, along either axis).
+        static constexpr float maxDrift = 0.5f;
+
+        int width = 0;
+        int height = 0;
+        AlignedBuffer<std::uint32_t> color;
+        AlignedBuffer<float> depth; // Reversed depth (see ZBuffer.hpp), whatever the framebuffer's format
+        AlignedBuffer<std::uint8_t> reused; // Per pixel of the current frame, 1 if its colour came from history
+        // Per pixel, where its colour was shaded relative to its centre, for the history and the current frame
+        AlignedBuffer<slib::vec2> drift;
+        AlignedBuffer<slib::vec2> currentDrift;
+        slib::mat4 view; // The history's view and projection
+        slib::mat4 projection;
+        bool valid = false;
+        unsigned int frame = 0;
+
+        // reprojection takes a pixel's (clip x, clip y, clip w, 1) to the history's clip space
+        template <DepthFormat format>
+        void reproject(
+            Framebuffer& framebuffer,
+            const std::array<std::array<float, 4>, 4>& reprojection,
+            float nearW,
+            JobSystem& jobs);
+
+      public:
+        TemporalCache();
+        // Fills in the framebuffer's colour wherever the history can be reused, and marks those pixels (see
+        // Reused). The framebuffer's depth must already be final.
+        void Reproject(
+            Framebuffer& framebuffer,
+            const slib::mat4& viewMatrix,
+            const slib::mat4& perspectiveMat,
+            float nearW,
+            JobSystem& jobs);
+        // Keeps the finished frame as the history for the next one. Follows the frame's Reproject.
+        void Store(
+            Framebuffer& framebuffer,
+            const slib::mat4& viewMatrix,
+            const slib::mat4& perspectiveMat,
+            JobSystem& jobs);
+        // Drops the history, so the next frame is shaded in full
+        void Invalidate();
+        // Per pixel, non-zero where Reproject copied the colour from history
+        const std::uint8_t* Reused() const
+        {
+            return reused.data();
+        }
+    };
+} // namespace sage
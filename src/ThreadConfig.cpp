@@ -0,0 +1,100 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#include "ThreadConfig.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace sage
+{
+    namespace
+    {
+        // Parses "a-b,c,..." into CPU indices. Returns false (leaving cpus partially filled) on bad input.
+        bool parseCpuList(std::string_view list, std::vector<int>& cpus)
+        {
+            while (!list.empty())
+            {
+                const auto comma = list.find(',');
+                const std::string_view range = list.substr(0, comma);
+                list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+
+                int first = 0, last = 0;
+                const auto dash = range.find('-');
+                const std::string_view firstText = range.substr(0, dash);
+                const std::string_view lastText =
+                    dash == std::string_view::npos ? firstText : range.substr(dash + 1);
+                auto parse = [](std::string_view text, int& value) {
+                    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+                    return error == std::errc{} && end == text.data() + text.size() && value >= 0;
+                };
+                if (!parse(firstText, first) || !parse(lastText, last) || last < first) return false;
+                for (int cpu = first; cpu <= last; ++cpu)
+                    cpus.push_back(cpu);
+            }
+            return true;
+        }
+    } // namespace
+
+    ThreadConfig ThreadConfig::FromEnvironment()
+    {
+        ThreadConfig config;
+        if (const char* threads = std::getenv("SAGE_RENDER_THREADS"))
+        {
+            const auto [end, error] = std::from_chars(threads, threads + std::strlen(threads), config.threadCount);
+            if (error != std::errc{} || *end != '\0')
+            {
+                std::cout << "Ignoring SAGE_RENDER_THREADS=" << threads << " (expected a number)" << std::endl;
+                config.threadCount = 0;
+            }
+        }
+        if (const char* cpus = std::getenv("SAGE_RENDER_CPUS"))
+        {
+            if (!parseCpuList(cpus, config.cpus))
+            {
+                std::cout << "Ignoring SAGE_RENDER_CPUS=" << cpus << " (expected a list such as 0-7,16-23)"
+                          << std::endl;
+                config.cpus.clear();
+            }
+        }
+        return config;
+    }
+
+    unsigned int ThreadConfig::Resolve() const
+    {
+        if (threadCount > 0) return threadCount;
+        if (!cpus.empty()) return static_cast<unsigned int>(cpus.size());
+        return std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    bool PinCurrentThread(int cpu)
+    {
+#ifdef _WIN32
+        if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) return false;
+        return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << cpu) != 0;
+#elif defined(__linux__)
+        if (cpu >= CPU_SETSIZE) return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        (void)cpu;
+        return false;
+#endif
+    }
+} // namespace sage
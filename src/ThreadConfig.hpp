@@ -0,0 +1,27 @@
+//
+// Created by Steve Wheeler on 19/10/2026.
+//
+
+#pragma once
+
+#include <vector>
+
+namespace sage
+{
+    // How many threads render and which CPUs they run on.
+    struct ThreadConfig
+    {
+        unsigned int threadCount = 0; // 0 uses one per CPU in cpus, or per hardware thread if that's empty too
+        // Worker i is pinned to cpus[i % cpus.size()]. Empty leaves scheduling to the OS.
+        std::vector<int> cpus;
+
+        // Reads SAGE_RENDER_THREADS (a count) and SAGE_RENDER_CPUS (a list such as "0-7,16-23"). Pinning a
+        // node's worth of cores on a multi-socket machine keeps the framebuffer on that node; see Framebuffer.
+        static ThreadConfig FromEnvironment();
+        // Total threads to run, resolving 0 as described above
+        unsigned int Resolve() const;
+    };
+
+    // Restricts the calling thread to one CPU. Returns false if that isn't supported or the CPU doesn't exist.
+    bool PinCurrentThread(int cpu);
+} // namespace sage
@@ -3,19 +3,158 @@
 //
 
 #pragma once
-#include "constants.hpp"
-#include <array>
+#include "AlignedBuffer.hpp"
+
+#include <algorithm>
+#include <cstdint>
 
 namespace sage
 {
-struct ZBuffer
-{
-    static constexpr unsigned long screenSize = SCREEN_WIDTH * SCREEN_HEIGHT;
-    std::array<float, screenSize> buffer{};
-    void
-    clear()
+    enum DepthFormat
+    {
+        DEPTH_32F,
+        DEPTH_24,
+        DEPTH_16
+    };
+
+    // Depths are reversed (1 at the near plane, falling towards 0 at infinity), so larger is closer and a
+    // cleared buffer (all zeros) is "infinitely far away" without needing a sentinel.
+    // DepthEncoding<format>::Encode converts a reversed depth to the value stored in the buffer, and Decode back.
+    template <DepthFormat format>
+    struct DepthEncoding;
+
+    template <>
+    struct DepthEncoding<DEPTH_32F>
+    {
+        using type = float;
+        static type Encode(float z)
+        {
+            return z;
+        }
+        static float Decode(type stored)
+        {
+            return stored;
+        }
+    };
+
+    // 24-bit unsigned normalised depth, kept in the low bits of 32-bit words (no bandwidth saving over 32F).
+    template <>
+    struct DepthEncoding<DEPTH_24>
+    {
+        using type = std::uint32_t;
+        static type Encode(float z)
+        {
+            return static_cast<type>(std::clamp(z, 0.0f, 1.0f) * 16777215.0f + 0.5f);
+        }
+        static float Decode(type stored)
+        {
+            return static_cast<float>(stored) / 16777215.0f;
+        }
+    };
+
+    // 16-bit unsigned normalised depth. Half the memory traffic of 32F, but coarse in the distance.
+    template <>
+    struct DepthEncoding<DEPTH_16>
     {
-        std::fill_n(buffer.begin(), screenSize, 0);
-    }
-};
-}
+        using type = std::uint16_t;
+        static type Encode(float z)
+        {
+            return static_cast<type>(std::clamp(z, 0.0f, 1.0f) * 65535.0f + 0.5f);
+        }
+        static float Decode(type stored)
+        {
+            return static_cast<float>(stored) / 65535.0f;
+        }
+    };
+
+    struct ZBuffer
+    {
+        ZBuffer() = default;
+
+        int Width() const
+        {
+            return width;
+        }
+
+        int Height() const
+        {
+            return height;
+        }
+
+        DepthFormat Format() const
+        {
+            return format;
+        }
+
+        // Without zeroFill the buffer is left uninitialised, for the caller to clear with clearRows.
+        void resize(int _width, int _height, bool zeroFill = true)
+        {
+            width = _width;
+            height = _height;
+            allocate(zeroFill);
+        }
+
+        // Only the buffer of the current format is allocated. zeroFill as for resize.
+        void setFormat(DepthFormat _format, bool zeroFill = true)
+        {
+            format = _format;
+            allocate(zeroFill);
+        }
+
+        template <DepthFormat F>
+        typename DepthEncoding<F>::type* Data()
+        {
+            if constexpr (F == DEPTH_32F)
+                return buffer32F.data();
+            else if constexpr (F == DEPTH_24)
+                return buffer24.data();
+            else
+                return buffer16.data();
+        }
+
+        void clear()
+        {
+            clearRows(0, height);
+        }
+
+        // Clears rows [begin, end)
+        void clearRows(int begin, int end)
+        {
+            clearRange(static_cast<std::size_t>(begin) * width, static_cast<std::size_t>(end) * width);
+        }
+
+        // Clears columns [begin, end) of row y
+        void clearSpan(int y, int begin, int end)
+        {
+            const auto row = static_cast<std::size_t>(y) * width;
+            clearRange(row + begin, row + end);
+        }
+
+      private:
+        int width = 0;
+        int height = 0;
+        DepthFormat format = DEPTH_32F;
+        AlignedBuffer<float> buffer32F;
+        AlignedBuffer<std::uint32_t> buffer24;
+        AlignedBuffer<std::uint16_t> buffer16;
+
+        void clearRange(std::size_t first, std::size_t last)
+        {
+            // Only the current format's buffer is allocated; the others are empty
+            auto clear = [first, last](auto& buffer) {
+                if (buffer.size() != 0) std::fill(buffer.begin() + first, buffer.begin() + last, 0);
+            };
+            clear(buffer32F);
+            clear(buffer24);
+            clear(buffer16);
+        }
+
+        void allocate(bool zeroFill = true)
+        {
+            const auto size = static_cast<std::size_t>(width) * height;
+            buffer32F.resize(format == DEPTH_32F ? size : 0, zeroFill);
+            buffer24.resize(format == DEPTH_24 ? size : 0, zeroFill);
+            buffer16.resize(format == DEPTH_16 ? size : 0, zeroFill);
+        }
+    };
+} // namespace sage
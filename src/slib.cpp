@@ -137,18 +137,16 @@ namespace slib
         return x == rhs && y == rhs && z == rhs;
     }
 
+    // Transforms the point, as rhs * vec4(point, 1)
     vec3 vec3::operator*(const mat4& rhs) const
     {
-        mat4 lhs({{this->x, this->y, this->z}});
-        lhs *= rhs;
-        return {lhs.data[0][0], lhs.data[0][1], lhs.data[0][2]};
+        const vec4 transformed = rhs * vec4(*this, 1);
+        return {transformed.x, transformed.y, transformed.z};
     }
 
     vec3& vec3::operator*=(const mat4& rhs)
     {
-        mat4 lhs({{this->x, this->y, this->z}});
-        lhs *= rhs;
-        *this = {lhs.data[0][0], lhs.data[0][1], lhs.data[0][2]};
+        *this = *this * rhs;
         return *this;
     }
 
@@ -182,20 +180,9 @@ namespace slib
 
     mat4& mat4::operator+=(const mat4& rhs)
     {
-        const auto rhsrows = rhs.data.size();
-        const auto rhscols = rhs.data.at(0).size();
-        const auto lhsrows = data.size();
-        const auto lhscols = data.at(0).size();
-
-        if (lhscols != rhsrows)
-        {
-            std::cout << "Error: mat-size mismatch." << std::endl;
-            exit(1);
-        }
-        auto maxCols = lhscols >= rhscols ? lhscols : rhscols;
-        for (int col = 0; col < static_cast<int>(maxCols); ++col)
+        for (size_t col = 0; col < 4; ++col)
         {
-            for (int row = 0; row < static_cast<int>(lhsrows); ++row)
+            for (size_t row = 0; row < 4; ++row)
             {
                 data[col][row] += rhs.data[col][row];
             }
@@ -205,25 +192,14 @@ namespace slib
 
     mat4& mat4::operator*=(const mat4& rhs)
     {
-        const auto rhsrows = rhs.data.size();
-        const auto rhscols = rhs.data[0].size();
-        const auto lhsrows = data.size();
-        const auto lhscols = data[0].size();
-
-        if (lhscols != rhsrows)
-        {
-            std::cout << "Error: mat-size mismatch." << std::endl;
-            exit(1);
-        }
-
-        std::vector<std::vector<float>> result(lhscols, std::vector<float>(rhsrows, 0));
+        std::array<std::array<float, 4>, 4> result{};
 
-        for (size_t i = 0; i < lhscols; ++i)
+        for (size_t i = 0; i < 4; ++i)
         {
-            for (size_t j = 0; j < rhsrows; ++j)
+            for (size_t j = 0; j < 4; ++j)
             {
                 float cellValue = 0;
-                for (size_t k = 0; k < lhsrows; ++k)
+                for (size_t k = 0; k < 4; ++k)
                 {
                     cellValue += data[k][i] * rhs.data[j][k];
                 }
@@ -237,7 +213,7 @@ namespace slib
 
     mat4 mat4::operator*(const mat4& rhs) const
     {
-        mat4 toReturn(data);
+        mat4 toReturn(*this);
         return toReturn *= rhs;
     }
 
@@ -1,6 +1,9 @@
 #pragma once
+#include <algorithm>
 #include <array>
+#include <initializer_list>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -19,6 +22,7 @@ namespace slib
         int w, h;
         std::vector<unsigned char> data;
         unsigned int bpp;
+        std::string path; // Where it was loaded from (the resource cache key)
     };
 
     struct material
@@ -31,9 +35,10 @@ namespace slib
         float Ni{};
         float d{};
         int illum{};
-        texture map_Kd;
-        texture map_Ks;
-        texture map_Ns;
+        // Shared with every other material using the same image (see ResourceCache). Null if absent.
+        std::shared_ptr<const texture> map_Kd;
+        std::shared_ptr<const texture> map_Ks;
+        std::shared_ptr<const texture> map_Ns;
     };
 
     struct zvec2
@@ -95,8 +100,16 @@ namespace slib
 
     struct mat4
     {
-        std::vector<std::vector<float>> data;
-        explicit mat4(std::vector<std::vector<float>> _data) : data(std::move(_data)){};
+        // Fixed size rather than nested vectors, so making and multiplying matrices never allocates
+        std::array<std::array<float, 4>, 4> data{};
+        explicit mat4(std::initializer_list<std::initializer_list<float>> rows)
+        {
+            size_t i = 0;
+            for (const auto& row : rows)
+            {
+                std::copy(row.begin(), row.end(), data[i++].begin());
+            }
+        };
 
         mat4& operator+=(const mat4& rhs);
         mat4& operator*=(const mat4& rhs);
@@ -114,6 +127,7 @@ namespace slib
         vec3 position;
         vec2 textureCoords;
         vec3 normal;
+        vec3 worldPoint;
         vec4 projectedPoint;
         vec3 screenPoint;
     };
@@ -124,7 +138,7 @@ namespace slib
         vertex v1;
         vertex v2;
         vertex v3;
-        std::string material;
+        int material = -1; // Index into the mesh's materials, -1 for none
     };
 
 } // namespace slib
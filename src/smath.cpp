@@ -36,7 +36,7 @@ namespace smath
     {
         return slib::vec3({
             v1.y * v2.z - v1.z * v2.y,
-            v1.z * v2.x - v1.x * v2.y,
+            v1.z * v2.x - v1.x * v2.z,
             v1.x * v2.y - v1.y * v2.x,
         });
     }